@@ -0,0 +1,69 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_AABB_H
+#define CPU_CPP_RAYTRACING_AABB_H
+#include <algorithm>
+#include <limits>
+#include "ray.h"
+#include "vec3.h"
+
+// axis aligned bounding box; the default one is empty and grows with expand()
+class aabb {
+public:
+    vec3 pmin;
+    vec3 pmax;
+    aabb() : pmin(INFINITY, INFINITY, INFINITY), pmax(-INFINITY, -INFINITY, -INFINITY) {}
+    aabb(const vec3 &a, const vec3 &b) : pmin(a), pmax(b) {}
+
+    void expand(const vec3 &p) {
+        for (int a = 0; a < 3; a++) {
+            pmin[a] = std::min(pmin[a], p[a]);
+            pmax[a] = std::max(pmax[a], p[a]);
+        }
+    }
+    void expand(const aabb &b) {
+        for (int a = 0; a < 3; a++) {
+            pmin[a] = std::min(pmin[a], b.pmin[a]);
+            pmax[a] = std::max(pmax[a], b.pmax[a]);
+        }
+    }
+
+    bool empty() const { return pmin[0] > pmax[0]; }
+    vec3 centroid() const { return 0.5f * (pmin + pmax); }
+    vec3 extent() const { return pmax - pmin; }
+
+    float surface_area() const {
+        if (empty()) return 0;
+        vec3 d = extent();
+        return 2 * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+    }
+
+    int longest_axis() const {
+        vec3 d = extent();
+        if (d[0] > d[1] && d[0] > d[2]) return 0;
+        return d[1] > d[2] ? 1 : 2;
+    }
+
+    // slab test; inv_dir is 1 / r.direction(), computed once per ray by the caller
+    inline bool hit(const ray &r, const vec3 &inv_dir, float t_min, float t_max) const {
+        for (int a = 0; a < 3; a++) {
+            float t0 = (pmin[a] - r.a[a]) * inv_dir[a];
+            float t1 = (pmax[a] - r.a[a]) * inv_dir[a];
+            if (inv_dir[a] < 0.0f) std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max < t_min) return false;
+        }
+        return true;
+    }
+};
+
+aabb surrounding_box(const aabb &a, const aabb &b) {
+    aabb box = a;
+    box.expand(b);
+    return box;
+}
+
+#endif //CPU_CPP_RAYTRACING_AABB_H
@@ -0,0 +1,95 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_ARENA_H
+#define CPU_CPP_RAYTRACING_ARENA_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that live exactly as long as a scene. Objects
+// are carved out of large blocks in allocation order, so a scene's materials
+// and objects sit next to each other instead of all over the heap, and
+// making one is a pointer bump instead of a malloc. reset() runs the
+// destructors (newest first) and rewinds, keeping the blocks for the next
+// scene; the destructor also gives the blocks back.
+class arena {
+public:
+    explicit arena(size_t block_size = 64 * 1024) : block_size(block_size) {}
+    ~arena() {
+        reset();
+        for (block &b : blocks) ::operator delete(b.data, std::align_val_t(block_alignment));
+    }
+
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        while (current < blocks.size()) {
+            block &b = blocks[current];
+            size_t start = (offset + alignment - 1) & ~(alignment - 1);
+            if (start + bytes <= b.size) {
+                offset = start + bytes;
+                used += bytes;
+                return b.data + start;
+            }
+            current++;
+            offset = 0;
+        }
+        // bigger than a block: it gets one of its own
+        size_t size = std::max(block_size, bytes + alignment);
+        blocks.push_back({(char *)::operator new(size, std::align_val_t(block_alignment)), size});
+        reserved += size;
+        current = blocks.size() - 1;
+        offset = 0;
+        return allocate(bytes, alignment);
+    }
+
+    template <class T, class... Args>
+    T *make(Args &&...args) {
+        static_assert(alignof(T) <= block_alignment, "over-aligned type");
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back({object, [](void *p) { static_cast<T *>(p)->~T(); }});
+        }
+        return object;
+    }
+
+    void reset() {
+        for (size_t i = destructors.size(); i-- > 0;) destructors[i].destroy(destructors[i].object);
+        destructors.clear();
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    size_t bytes_used() const { return used; }
+    size_t bytes_reserved() const { return reserved; }
+
+private:
+    static const size_t block_alignment = 64;
+
+    struct block {
+        char *data;
+        size_t size;
+    };
+    struct destructor {
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    size_t block_size;
+    std::vector<block> blocks;
+    std::vector<destructor> destructors;
+    size_t current = 0;     // block being filled
+    size_t offset = 0;      // into it
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+#endif //CPU_CPP_RAYTRACING_ARENA_H
@@ -0,0 +1,557 @@
+// Benchmarks: microbenchmarks of the hot primitives and end-to-end renders of
+// the built-in scenes on 1..N threads. Progress and a readable summary go to
+// stderr, the results as JSON to stdout (or --json FILE) for tracking
+// regressions between versions.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "camera.h"
+#include "common.h"
+#include "cube.h"
+#include "denoise.h"
+#include "film.h"
+#include "hitable_list.h"
+#include "image_texture.h"
+#include "materials.h"
+#include "renderer.h"
+#include "sampler.h"
+#include "scenes.h"
+#include "simd.h"
+#include "sphere.h"
+#include "thread_pool.h"
+
+struct bench_options {
+    bool quick = false;         // smaller scenes and shorter runs, for a smoke test
+    int max_threads = 0;        // 0 = hardware threads
+    std::string filter;         // only benchmarks whose name contains this
+    std::string json;           // empty = stdout
+};
+
+using bench_clock = std::chrono::steady_clock;
+
+double seconds_since(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// keeps results alive so the measured code is not optimized away
+volatile uint64_t bench_sink;
+
+struct micro_result {
+    std::string name;
+    double ns_per_op;
+};
+
+// Runs batch(ops) until min_seconds have passed, three times, and keeps the
+// fastest run. batch returns a value that feeds the sink.
+template <class batch_fn>
+micro_result run_micro(const char *name, int ops, double min_seconds, batch_fn &&batch) {
+    double best = INFINITY;
+    for (int round = 0; round < 3; round++) {
+        uint64_t total_ops = 0, sink = 0;
+        auto start = bench_clock::now();
+        double seconds;
+        do {
+            sink += batch();
+            total_ops += ops;
+        } while ((seconds = seconds_since(start)) < min_seconds);
+        bench_sink = bench_sink + sink;
+        best = std::min(best, seconds * 1e9 / double(total_ops));
+    }
+    fprintf(stderr, "  %-32s %8.2f ns/op  %8.2f Mops/s\n", name, best, 1e3 / best);
+    return {name, best};
+}
+
+// Counts hit() calls on the world, i.e. rays traced. Every thread bumps its
+// own cache line; the counters are only summed once a render has finished.
+class counting_world : public hitable {
+public:
+    explicit counting_world(hitable *inner) : inner(inner) {}
+
+    virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
+        local_counter()++;
+        return inner->hit(r, t_min, t_max, rec);
+    }
+    virtual bool bounding_box(aabb &box) const { return inner->bounding_box(box); }
+    virtual const light_list *lights() const { return inner->lights(); }
+
+    static uint64_t total() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        uint64_t sum = 0;
+        for (auto &c : registry) sum += c->value;
+        return sum;
+    }
+
+    static void reset() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto &c : registry) c->value = 0;
+    }
+
+private:
+    struct alignas(64) counter {
+        uint64_t value = 0;
+    };
+
+    hitable *inner;
+    static inline std::mutex registry_mutex;
+    static inline std::vector<std::unique_ptr<counter>> registry;
+
+    static uint64_t &local_counter() {
+        thread_local counter *c = nullptr;
+        if (!c) {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            registry.push_back(std::make_unique<counter>());
+            c = registry.back().get();
+        }
+        return c->value;
+    }
+};
+
+// rays from around the default camera into the scene, about half of them hitting
+std::vector<ray> random_rays(int n, const vec3 &target, float spread, uint64_t seed) {
+    pcg32 rng;
+    rng.seed(mix64(seed), 3);
+    std::vector<ray> rays(n);
+    for (ray &r : rays) {
+        vec3 origin(rng.next_float() - 0.5f, rng.next_float() - 0.5f, 1.0f);
+        vec3 jitter(rng.next_float() - 0.5f, rng.next_float() - 0.5f, rng.next_float() - 0.5f);
+        r = ray(origin, target + spread * jitter - origin);
+    }
+    return rays;
+}
+
+std::vector<micro_result> run_micro_benchmarks(const bench_options &opt) {
+    std::vector<micro_result> results;
+    const double min_seconds = opt.quick ? 0.02 : 0.2;
+    const int n = 1024;
+    auto wanted = [&](const std::string &name) { return opt.filter.empty() || name.find(opt.filter) != std::string::npos; };
+
+    std::vector<ray> rays = random_rays(n, vec3(0, 0, -1), 1.5f, 1);
+    lambertian diffuse(vec3(0.8, 0.3, 0.3));
+    metal shiny(vec3(0.8, 0.8, 0.8), 0.1f);
+    dielectric glass(1.5f);
+
+    sphere ball(vec3(0, 0, -1), 0.5f, &diffuse);
+    if (wanted("sphere::hit")) {
+        results.push_back(run_micro("sphere::hit", n, min_seconds, [&] {
+            uint64_t hits = 0;
+            hit_record rec;
+            for (const ray &r : rays) hits += ball.hit(r, 0.001f, INFINITY, rec);
+            return hits;
+        }));
+    }
+
+    cube box(vec3(0, 0, -1), 0.8f, &diffuse);
+    triangle face = unit_triangles[0];
+    face.v0 = face.v0 * 0.8f + box.position;
+    face.v1 = face.v1 * 0.8f + box.position;
+    face.v2 = face.v2 * 0.8f + box.position;
+    if (wanted("ray_triangle_intersect")) {
+        results.push_back(run_micro("ray_triangle_intersect", n, min_seconds, [&] {
+            uint64_t hits = 0;
+            float t;
+            vec3 normal;
+            for (const ray &r : rays) hits += ray_triangle_intersect(r, face, 0.001f, INFINITY, t, normal);
+            return hits;
+        }));
+    }
+
+    // the original five-object world, next to each other in an arena
+    arena objects;
+    hitable *list[5] = {
+        objects.make<sphere>(vec3(0, 0, -1), 0.2, &diffuse),
+        objects.make<sphere>(vec3(0, -100.5, -1), 100, &diffuse),
+        objects.make<cube>(vec3(-0.7, 0, -1), 0.5, &diffuse),
+        objects.make<cube>(vec3(0.0, 0, -1), 0.5, &glass),
+        objects.make<sphere>(vec3(0.5, 0, -1.2), 0.2, &shiny),
+    };
+    hitable_list world(list, 5);
+    if (wanted("hitable_list::hit")) {
+        results.push_back(run_micro("hitable_list::hit", n, min_seconds, [&] {
+            uint64_t hits = 0;
+            hit_record rec;
+            for (const ray &r : rays) hits += world.hit(r, 0.001f, INFINITY, rec);
+            return hits;
+        }));
+    }
+
+    // the packet kernels at every level this cpu runs, 8 primitives per call
+    sphere_packet spheres = {};
+    triangle_packet triangles = {};
+    pcg32 rng;
+    rng.seed(5, 5);
+    for (int lane = 0; lane < packet_width; lane++) {
+        vec3 c(rng.next_float() * 2 - 1, rng.next_float() - 0.5f, -1 - rng.next_float());
+        spheres.set(lane, c, 0.15f);
+        triangles.set(lane, c, c + vec3(0.4f, 0, 0), c + vec3(0, 0.4f, 0.1f));
+    }
+    for (int level = simd_scalar; level <= best_simd_level(); level++) {
+        simd_kernels kernels = make_simd_kernels(simd_level(level));
+        std::string name = std::string("sphere_packet/") + kernels.name;
+        if (wanted(name)) {
+            results.push_back(run_micro(name.c_str(), n, min_seconds, [&] {
+                uint64_t hits = 0;
+                for (const ray &r : rays) {
+                    float t_max = INFINITY;
+                    hits += kernels.spheres(r, spheres, packet_width, 0.001f, t_max) >= 0;
+                }
+                return hits;
+            }));
+        }
+        name = std::string("triangle_packet/") + kernels.name;
+        if (wanted(name)) {
+            results.push_back(run_micro(name.c_str(), n, min_seconds, [&] {
+                uint64_t hits = 0;
+                for (const ray &r : rays) {
+                    float t_max = INFINITY;
+                    hits += kernels.triangles(r, triangles, packet_width, 0.001f, t_max) >= 0;
+                }
+                return hits;
+            }));
+        }
+    }
+
+    // 5-octave fBm of a batch of points at every level, per point
+    std::vector<float> noise_x(n), noise_y(n), noise_z(n), noise_out(n);
+    for (int i = 0; i < n; i++) {
+        noise_x[i] = rng.next_float() * 64 - 32;
+        noise_y[i] = rng.next_float() * 64 - 32;
+        noise_z[i] = rng.next_float() * 64 - 32;
+    }
+    fbm_settings octaves;
+    for (int level = simd_scalar; level <= best_simd_level(); level++) {
+        std::string name = std::string("fbm_points/") + make_simd_kernels(simd_level(level)).name;
+        if (!wanted(name)) continue;
+        fbm_kernel kernel = fbm_kernel_for(simd_level(level));
+        results.push_back(run_micro(name.c_str(), n, min_seconds, [&] {
+            kernel(noise_permutation().perm, noise_x.data(), noise_y.data(), noise_z.data(), n, octaves,
+                   noise_out.data());
+            return uint64_t(noise_out[n - 1] > 0);
+        }));
+    }
+
+    // 2D points as a path draws them: a new pixel sample every 16
+    for (int type = 0; type < sampler_type_count; type++) {
+        std::string name = std::string("sampler::next_2d/") + sampler_type_names[type];
+        if (!wanted(name)) continue;
+        sampler points(7, sampler_type(type), 64);
+        results.push_back(run_micro(name.c_str(), n, min_seconds, [&] {
+            float sum = 0;
+            for (int i = 0; i < n; i++) {
+                if (i % 16 == 0) points.start_pixel_sample(i >> 4 & 63, i >> 10 & 63, uint32_t(i) >> 16);
+                sum += points.next_2d().x;
+            }
+            return uint64_t(sum != 12345.0f);
+        }));
+    }
+
+    sampler s(7);
+    s.start_pixel_sample(0, 0, 1);
+    if (wanted("random_in_unit_sphere")) {
+        results.push_back(run_micro("random_in_unit_sphere", n, min_seconds, [&] {
+            float sum = 0;
+            for (int i = 0; i < n; i++) sum += random_in_unit_sphere(s).x();
+            return uint64_t(sum != 12345.0f);
+        }));
+    }
+    if (wanted("sample_cosine_hemisphere")) {
+        results.push_back(run_micro("sample_cosine_hemisphere", n, min_seconds, [&] {
+            float sum = 0;
+            for (int i = 0; i < n; i++) sum += sample_cosine_hemisphere(vec3(0, 0.6f, 0.8f), s.next_2d()).x();
+            return uint64_t(sum != 12345.0f);
+        }));
+    }
+
+    // every material scatters from a point on the sphere, hit from the rays above
+    hit_record rec;
+    rec.t = 1;
+    rec.p = vec3(0, 0, -0.5f);
+    rec.normal = vec3(0, 0, 1);
+    // and the procedural ones, to compare with the flat ones
+    noise_texture stone(vec3(0.2, 0.2, 0.4), vec3(0.6, 0.6, 0.8), 12);
+    lambertian textured(&stone);
+    bump bumpy(&diffuse, 30, 0.4f);
+    const material *materials[5] = {&diffuse, &shiny, &glass, &textured, &bumpy};
+    const char *names[5] = {"lambertian::scatter", "metal::scatter", "dielectric::scatter",
+                            "lambertian::scatter/noise", "bump::scatter"};
+    for (int m = 0; m < 5; m++) {
+        if (!wanted(names[m])) continue;
+        rec.mat_ptr = const_cast<material *>(materials[m]);
+        results.push_back(run_micro(names[m], n, min_seconds, [&] {
+            uint64_t scattered_count = 0;
+            vec3 attenuation;
+            ray scattered;
+            for (const ray &r : rays) scattered_count += materials[m]->scatter(r, rec, attenuation, scattered, s);
+            return scattered_count;
+        }));
+    }
+
+    // image texture lookups through the tile cache, once every tile is in it:
+    // neighbouring hits, scattered hits, and scattered hits with a ray cone
+    // wide enough for trilinear filtering between the coarser levels
+    if (wanted("image_texture")) {
+        const int size = 2048;
+        std::string image_path = (std::filesystem::temp_directory_path() / "rt_bench_texture.ppm").string();
+        std::vector<rgba8> pixels(size_t(size) * size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                float c = 0.5f + 0.5f * std::sin(x * 0.05f) * std::cos(y * 0.03f);
+                pixels[size_t(y) * size + x] = to_rgba8(vec3(c, 1 - c, c * c));
+            }
+        }
+        std::unique_ptr<tiled_image> tiles;
+        if (write_ppm(image_path, pixels, size, size)) tiles = tiled_image::open(image_path);
+        if (tiles) {
+            image_texture image(std::move(tiles));
+            std::vector<hit_record> hits(n);
+            for (int i = 0; i < n; i++) {
+                hits[i].u = rng.next_float();
+                hits[i].v = rng.next_float();
+                hits[i].uv_length = 1;
+            }
+            const char *cases[3] = {"image_texture::value/coherent", "image_texture::value/incoherent",
+                                    "image_texture::value/cone"};
+            for (int c = 0; c < 3; c++) {
+                for (int i = 0; i < n; i++) {
+                    if (c == 0) {
+                        hits[i].u = 0.3f + (i % 32) * 0.5f / size;
+                        hits[i].v = 0.6f + (i / 32) * 0.5f / size;
+                    }
+                    hits[i].footprint = c == 2 ? 5.5f / size : 0;
+                }
+                if (!wanted(cases[c])) continue;
+                for (const hit_record &h : hits) image.value(h);    // warm the cache
+                results.push_back(run_micro(cases[c], n, min_seconds, [&] {
+                    float sum = 0;
+                    for (const hit_record &h : hits) sum += image.value(h).x();
+                    return uint64_t(sum != 12345.0f);
+                }));
+            }
+        }
+        std::remove(image_path.c_str());
+        std::remove((image_path + ".tiles").c_str());
+    }
+
+    return results;
+}
+
+struct scene_run {
+    int threads;
+    double seconds;
+    double samples_per_second;
+    double rays_per_second;
+};
+
+struct scene_result {
+    std::string name;
+    int nx, ny, spp;
+    std::vector<scene_run> runs;
+};
+
+std::vector<int> thread_counts(int max_threads) {
+    std::vector<int> counts;
+    for (int t = 1; t < max_threads; t *= 2) counts.push_back(t);
+    counts.push_back(max_threads);
+    return counts;
+}
+
+scene_result run_scene(const char *name, scene &world, int nx, int ny, int spp, const std::vector<int> &threads) {
+    world.build();
+    counting_world counted(&world);
+    camera cam(vec3(1, 0.5, -0.5), vec3(0, 0, -1), vec3(0, 1, 0), 45, float(nx) / float(ny));
+    render_settings settings;
+    settings.samples_per_pass = spp;
+
+    scene_result result{name, nx, ny, spp, {}};
+    fprintf(stderr, "  %s, %dx%d @ %d spp\n", name, nx, ny, spp);
+    for (int t : threads) {
+        tile_scheduler pool(t);
+        film image(nx, ny);
+        counting_world::reset();
+        auto start = bench_clock::now();
+        render_pass(pool, image, &counted, cam, settings);
+        double seconds = seconds_since(start);
+        double samples = double(image.total_samples());
+        scene_run run{t, seconds, samples / seconds, double(counting_world::total()) / seconds};
+        double speedup = result.runs.empty() ? 1.0 : result.runs[0].seconds / seconds;
+        fprintf(stderr, "    %3d threads: %7.3fs  %8.3f Msamples/s  %8.3f Mrays/s  speedup %5.2f\n", t, seconds,
+                run.samples_per_second * 1e-6, run.rays_per_second * 1e-6, speedup);
+        result.runs.push_back(run);
+    }
+    return result;
+}
+
+struct denoise_run {
+    int threads;
+    double ms;
+    double ms_per_megapixel;
+};
+
+struct denoise_result {
+    int nx = 0, ny = 0, spp = 0;
+    std::vector<denoise_run> runs;     // empty if not run
+};
+
+// The denoiser alone on a low-sample render of the default scene, fastest
+// of three runs per thread count. Rendering and the feature pass are not
+// timed.
+denoise_result run_denoise(int nx, int ny, int spp, const std::vector<int> &threads) {
+    scene world;
+    default_scene(world);
+    world.build();
+    camera cam(vec3(1, 0.5, -0.5), vec3(0, 0, -1), vec3(0, 1, 0), 45, float(nx) / float(ny));
+    render_settings settings;
+    settings.samples_per_pass = spp;
+    film image(nx, ny);
+    feature_buffers features;
+    {
+        tile_scheduler pool(threads.back());
+        render_pass(pool, image, &world, cam, settings);
+        render_features(pool, &world, cam, nx, ny, features);
+    }
+
+    denoise_result result{nx, ny, spp, {}};
+    fprintf(stderr, "  %dx%d @ %d spp\n", nx, ny, spp);
+    double megapixels = double(nx) * ny * 1e-6;
+    for (int t : threads) {
+        tile_scheduler pool(t);
+        denoiser filter;
+        film out(0, 0);
+        double best = INFINITY;
+        for (int round = 0; round < 3; round++) {
+            auto start = bench_clock::now();
+            filter.run(pool, image, features, out);
+            best = std::min(best, seconds_since(start) * 1e3);
+        }
+        bench_sink = bench_sink + uint64_t(out.sum[0][0] * 1000);
+        denoise_run run{t, best, best / megapixels};
+        double speedup = result.runs.empty() ? 1.0 : result.runs[0].ms / best;
+        fprintf(stderr, "    %3d threads: %8.2f ms  %8.2f ms/megapixel  speedup %5.2f\n", t, run.ms,
+                run.ms_per_megapixel, speedup);
+        result.runs.push_back(run);
+    }
+    return result;
+}
+
+void write_json(FILE *out, const bench_options &opt, int max_threads, const std::vector<micro_result> &micro,
+                const std::vector<scene_result> &scenes, const denoise_result &denoise) {
+    fprintf(out, "{\n  \"simd\": \"%s\",\n  \"hardware_threads\": %d,\n  \"max_threads\": %d,\n  \"quick\": %s,\n",
+            simd.name, default_thread_count(), max_threads, opt.quick ? "true" : "false");
+    fprintf(out, "  \"micro\": [");
+    for (size_t i = 0; i < micro.size(); i++) {
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"ns_per_op\": %.4f, \"mops_per_second\": %.4f}", i ? "," : "",
+                micro[i].name.c_str(), micro[i].ns_per_op, 1e3 / micro[i].ns_per_op);
+    }
+    fprintf(out, "\n  ],\n  \"scenes\": [");
+    for (size_t i = 0; i < scenes.size(); i++) {
+        const scene_result &s = scenes[i];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"spp\": %d, \"runs\": [", i ? "," : "",
+                s.name.c_str(), s.nx, s.ny, s.spp);
+        for (size_t k = 0; k < s.runs.size(); k++) {
+            const scene_run &r = s.runs[k];
+            fprintf(out, "%s\n      {\"threads\": %d, \"seconds\": %.6f, \"samples_per_second\": %.1f, "
+                         "\"rays_per_second\": %.1f, \"speedup\": %.4f}",
+                    k ? "," : "", r.threads, r.seconds, r.samples_per_second, r.rays_per_second,
+                    s.runs[0].seconds / r.seconds);
+        }
+        fprintf(out, "\n    ]}");
+    }
+    fprintf(out, "\n  ]");
+    if (!denoise.runs.empty()) {
+        fprintf(out, ",\n  \"denoise\": {\"width\": %d, \"height\": %d, \"spp\": %d, \"runs\": [", denoise.nx,
+                denoise.ny, denoise.spp);
+        for (size_t k = 0; k < denoise.runs.size(); k++) {
+            const denoise_run &r = denoise.runs[k];
+            fprintf(out, "%s\n    {\"threads\": %d, \"ms\": %.3f, \"ms_per_megapixel\": %.3f, \"speedup\": %.4f}",
+                    k ? "," : "", r.threads, r.ms, r.ms_per_megapixel, denoise.runs[0].ms / r.ms);
+        }
+        fprintf(out, "\n  ]}");
+    }
+    fprintf(out, "\n}\n");
+}
+
+void print_bench_usage(const char *exe) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --quick             small scenes and short runs\n"
+            "  --threads N         highest thread count for the scaling runs (default: hardware threads)\n"
+            "  --filter TEXT       only run benchmarks whose name contains TEXT\n"
+            "  --json FILE         write the results to FILE instead of stdout\n",
+            exe);
+}
+
+int main(int argc, char **argv) {
+    bench_options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--quick")) opt.quick = true;
+        else if (!strcmp(arg, "--threads") && has_value) opt.max_threads = atoi(argv[++i]);
+        else if (!strcmp(arg, "--filter") && has_value) opt.filter = argv[++i];
+        else if (!strcmp(arg, "--json") && has_value) opt.json = argv[++i];
+        else {
+            print_bench_usage(argv[0]);
+            return !strcmp(arg, "--help") || !strcmp(arg, "-h") ? 0 : 1;
+        }
+    }
+    int max_threads = opt.max_threads > 0 ? opt.max_threads : default_thread_count();
+    auto wanted = [&](const std::string &name) { return opt.filter.empty() || name.find(opt.filter) != std::string::npos; };
+
+    fprintf(stderr, "micro benchmarks (simd: %s)\n", simd.name);
+    std::vector<micro_result> micro = run_micro_benchmarks(opt);
+
+    fprintf(stderr, "scenes\n");
+    std::vector<int> threads = thread_counts(max_threads);
+    int nx = opt.quick ? 160 : 480, ny = nx / 2;
+    std::vector<scene_result> scenes;
+    scene world;    // cleared and refilled for every scene
+    if (wanted("default")) {
+        default_scene(world);
+        scenes.push_back(run_scene("default", world, nx, ny, opt.quick ? 2 : 16, threads));
+        world.clear();
+    }
+    if (wanted("interior")) {
+        interior_scene(world);
+        scenes.push_back(run_scene("interior", world, nx, ny, opt.quick ? 2 : 16, threads));
+        world.clear();
+    }
+    if (wanted("spheres")) {
+        sphere_field(world, opt.quick ? 1000 : 100000, 0);
+        scenes.push_back(run_scene("spheres", world, nx, ny, opt.quick ? 1 : 4, threads));
+        world.clear();
+    }
+    if (wanted("cubes")) {
+        cube_field(world, opt.quick ? 1000 : 100000, 0);
+        scenes.push_back(run_scene("cubes", world, nx, ny, opt.quick ? 1 : 4, threads));
+        world.clear();
+    }
+    if (wanted("mesh")) {
+        mesh_scene(world, "", opt.quick ? 20000 : 1000000, false);
+        scenes.push_back(run_scene("mesh", world, nx, ny, opt.quick ? 1 : 8, threads));
+        world.clear();
+    }
+
+    denoise_result denoise;
+    if (wanted("denoise")) {
+        fprintf(stderr, "denoise\n");
+        denoise = opt.quick ? run_denoise(320, 180, 4, threads) : run_denoise(1280, 720, 8, threads);
+    }
+
+    FILE *out = opt.json.empty() ? stdout : fopen(opt.json.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", opt.json.c_str());
+        return 1;
+    }
+    write_json(out, opt, max_threads, micro, scenes, denoise);
+    if (out != stdout) fclose(out);
+    return 0;
+}
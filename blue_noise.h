@@ -0,0 +1,104 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_BLUE_NOISE_H
+#define CPU_CPP_RAYTRACING_BLUE_NOISE_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// A tile of ranks 0..size^2-1 whose pixels below any threshold form a blue
+// noise pattern (void and cluster, Ulichney 1993): evenly spread, without
+// low frequencies. Energies use a Gaussian on the torus, so the tile repeats
+// without seams. Made once, on first use, always the same.
+struct blue_noise_tile {
+    static const int size = 64;
+    uint32_t rank[size * size];
+
+    uint32_t at(int x, int y) const { return rank[(y & (size - 1)) * size + (x & (size - 1))]; }
+};
+
+inline blue_noise_tile make_blue_noise_tile() {
+    const int size = blue_noise_tile::size, n = size * size;
+    const float sigma = 1.5f;
+    std::vector<float> kernel(n);      // by toroidal offset
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int dx = std::min(x, size - x), dy = std::min(y, size - y);
+            kernel[y * size + x] = std::exp(-float(dx * dx + dy * dy) / (2 * sigma * sigma));
+        }
+    }
+
+    // energy[p]: the kernel summed over the set pixels around p
+    std::vector<char> on(n, 0);
+    std::vector<float> energy(n, 0.0f);
+    auto toggle = [&](int p) {
+        float sign = on[p] ? -1.0f : 1.0f;
+        on[p] = !on[p];
+        int px = p % size, py = p / size;
+        for (int y = 0; y < size; y++) {
+            const float *row = &kernel[((y - py) & (size - 1)) * size];
+            for (int x = 0; x < size; x++) energy[y * size + x] += sign * row[(x - px) & (size - 1)];
+        }
+    };
+    // the set pixel in the tightest cluster, or the unset one in the largest void
+    auto extreme = [&](bool set) {
+        int best = -1;
+        for (int p = 0; p < n; p++) {
+            if (on[p] != set) continue;
+            if (best < 0 || (set ? energy[p] > energy[best] : energy[p] < energy[best])) best = p;
+        }
+        return best;
+    };
+
+    // a tenth of the pixels, hashed, then moved from clusters into voids until stable
+    int initial = n / 10;
+    uint32_t h = 0x2545f491u;
+    for (int placed = 0; placed < initial;) {
+        h ^= h << 13;
+        h ^= h >> 17;
+        h ^= h << 5;
+        int p = int(h % uint32_t(n));
+        if (!on[p]) {
+            toggle(p);
+            placed++;
+        }
+    }
+    for (int moves = 0; moves < n; moves++) {
+        int cluster = extreme(true);
+        toggle(cluster);
+        int gap = extreme(false);
+        toggle(gap);
+        if (gap == cluster) break;
+    }
+
+    blue_noise_tile tile;
+    std::vector<char> start_on = on;
+    std::vector<float> start_energy = energy;
+    // ranks below the initial pattern: take out the tightest clusters
+    for (int r = initial - 1; r >= 0; r--) {
+        int cluster = extreme(true);
+        toggle(cluster);
+        tile.rank[cluster] = uint32_t(r);
+    }
+    // and above it: fill the largest voids. With a kernel that sums to the
+    // same everywhere, that is also the tightest cluster of the unset pixels
+    // once they are the minority.
+    on = start_on;
+    energy = start_energy;
+    for (int r = initial; r < n; r++) {
+        int gap = extreme(false);
+        toggle(gap);
+        tile.rank[gap] = uint32_t(r);
+    }
+    return tile;
+}
+
+inline const blue_noise_tile &blue_noise() {
+    static const blue_noise_tile tile = make_blue_noise_tile();
+    return tile;
+}
+
+#endif //CPU_CPP_RAYTRACING_BLUE_NOISE_H
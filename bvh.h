@@ -0,0 +1,292 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_BVH_H
+#define CPU_CPP_RAYTRACING_BVH_H
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "aabb.h"
+#include "hitable.h"
+#include "render_stats.h"
+
+// 32 bytes, two nodes per cache line. Nodes are stored depth first, so the
+// first child of an interior node is always the next node in the array.
+struct bvh_node {
+    aabb bounds;
+    int offset;      // leaf: first primitive, interior: index of the second child
+    uint16_t count;  // primitives in a leaf, 0 for interior nodes
+    uint16_t axis;   // split axis, picks which child to visit first
+};
+
+struct bvh_build_stats {
+    int primitives = 0;
+    int nodes = 0;
+    int leaves = 0;
+    int max_depth = 0;
+    float sah_cost = 0;    // expected cost of a ray through the root, in node visits
+    double build_ms = 0;
+
+    void print(const char *name) const {
+        fprintf(stderr, "%s: %d prims, %d nodes, %d leaves (%.2f prims/leaf), depth %d, SAH cost %.2f, built in %.2f ms\n",
+                name, primitives, nodes, leaves, leaves ? float(primitives) / leaves : 0.0f, max_depth, sah_cost, build_ms);
+    }
+};
+
+struct bvh_traversal_stats {
+    uint64_t rays = 0;
+    uint64_t nodes_visited = 0;
+    uint64_t prims_tested = 0;
+
+    void print(const char *name) const {
+        fprintf(stderr, "%s: %llu rays, %.2f nodes and %.2f primitive tests per ray\n", name, (unsigned long long)rays,
+                rays ? double(nodes_visited) / rays : 0.0, rays ? double(prims_tested) / rays : 0.0);
+    }
+};
+
+// Traverses a flattened node array: bvh_tree::nodes, or one mapped from a
+// compiled scene file. Rays are counted by the caller, which may run several
+// trees per ray. leaf(first, count, closest) tests the primitives [first, first + count) (in
+// prim_index order) and shrinks closest on a hit.
+// Children are visited near to far and skipped once closest is in front of their box.
+template <bool count_stats = false, class leaf_fn>
+inline bool bvh_intersect(const bvh_node *nodes, size_t node_count, const ray &r, float t_min, float &closest,
+                          leaf_fn &&leaf, bvh_traversal_stats *traversal = nullptr) {
+    if (node_count == 0) return false;
+    vec3 inv_dir(1.0f / r.b[0], 1.0f / r.b[1], 1.0f / r.b[2]);
+    bool dir_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+    int stack[128];
+    int sp = 0;
+    int current = 0;
+    bool hit_anything = false;
+    while (true) {
+        const bvh_node &node = nodes[current];
+        if constexpr (count_stats) traversal->nodes_visited++;
+        if (node.bounds.hit(r, inv_dir, t_min, closest)) {
+            if (node.count > 0) {
+                if constexpr (count_stats) traversal->prims_tested += node.count;
+                if (leaf(node.offset, (int)node.count, closest)) hit_anything = true;
+                if (sp == 0) break;
+                current = stack[--sp];
+            } else if (dir_neg[node.axis]) {
+                stack[sp++] = current + 1;
+                current = node.offset;
+            } else {
+                stack[sp++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (sp == 0) break;
+            current = stack[--sp];
+        }
+    }
+    return hit_anything;
+}
+
+// Primitive-agnostic BVH: built from a list of bounds with binned SAH, then
+// flattened into one contiguous node array. After build() the owner reorders
+// its primitives by prim_index so every leaf covers a contiguous range.
+class bvh_tree {
+public:
+    std::vector<bvh_node> nodes;
+    std::vector<int> prim_index;
+    bvh_build_stats stats;
+
+    // prim_cost is the cost of one primitive test relative to a node visit; a
+    // low value (cheap SIMD leaves) makes the builder keep larger leaves
+    void build(const std::vector<aabb> &prim_bounds, int max_leaf_size = 4, float prim_cost = 1.0f) {
+        auto start = std::chrono::steady_clock::now();
+        int n = (int)prim_bounds.size();
+        nodes.clear();
+        prim_index.resize(n);
+        stats = bvh_build_stats();
+        stats.primitives = n;
+
+        std::vector<build_prim> prims(n);
+        for (int i = 0; i < n; i++) {
+            prims[i].bounds = prim_bounds[i];
+            prims[i].centroid = prim_bounds[i].centroid();
+            prims[i].index = i;
+        }
+        if (n > 0) {
+            nodes.reserve(2 * n);
+            build_recursive(prims, 0, n, 1, max_leaf_size, prim_cost);
+            stats.sah_cost /= nodes[0].bounds.surface_area() > 0 ? nodes[0].bounds.surface_area() : 1;
+        }
+        for (int i = 0; i < n; i++) prim_index[i] = prims[i].index;
+        nodes.shrink_to_fit();
+        stats.nodes = (int)nodes.size();
+        stats.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    aabb bounds() const {
+        return nodes.empty() ? aabb() : nodes[0].bounds;
+    }
+
+    // see bvh_intersect
+    template <bool count_stats = false, class leaf_fn>
+    inline bool intersect(const ray &r, float t_min, float &closest, leaf_fn &&leaf,
+                          bvh_traversal_stats *traversal = nullptr) const {
+        return bvh_intersect<count_stats>(nodes.data(), nodes.size(), r, t_min, closest, leaf, traversal);
+    }
+
+private:
+    struct build_prim {
+        aabb bounds;
+        vec3 centroid;
+        int index;
+    };
+
+    static const int bin_count = 16;
+    static const int max_depth = 64; // SAH levels; the traversal stack is 128 deep
+
+    int build_recursive(std::vector<build_prim> &prims, int begin, int end, int depth, int max_leaf_size, float prim_cost) {
+        int node_index = (int)nodes.size();
+        nodes.emplace_back();
+        stats.max_depth = std::max(stats.max_depth, depth);
+
+        aabb bounds, centroid_bounds;
+        for (int i = begin; i < end; i++) {
+            bounds.expand(prims[i].bounds);
+            centroid_bounds.expand(prims[i].centroid);
+        }
+        nodes[node_index].bounds = bounds;
+        int count = end - begin;
+
+        auto make_leaf = [&]() {
+            nodes[node_index].offset = begin;
+            nodes[node_index].count = (uint16_t)count;
+            nodes[node_index].axis = 0;
+            stats.leaves++;
+            stats.sah_cost += bounds.surface_area() * count * prim_cost;
+            return node_index;
+        };
+
+        int axis = centroid_bounds.longest_axis();
+        float lo = centroid_bounds.pmin[axis];
+        float extent = centroid_bounds.pmax[axis] - lo;
+        // coincident centroids cannot be separated by a split plane
+        if (count == 1 || ((extent <= 0.0f || depth >= max_depth) && count <= max_leaf_size)) return make_leaf();
+
+        // past max_depth (or without a usable plane) only median splits are made, which
+        // halve the count, so leaves never exceed max_leaf_size and depth stays bounded
+        int mid = begin + count / 2;
+        if (extent > 0.0f && depth < max_depth) {
+            // binned SAH: bucket the centroids and sweep the bin boundaries
+            int bin_counts[bin_count] = {};
+            aabb bin_bounds[bin_count];
+            auto bin_of = [&](const build_prim &p) {
+                int b = int(bin_count * ((p.centroid[axis] - lo) / extent));
+                return std::min(b, bin_count - 1);
+            };
+            for (int i = begin; i < end; i++) {
+                int b = bin_of(prims[i]);
+                bin_counts[b]++;
+                bin_bounds[b].expand(prims[i].bounds);
+            }
+
+            float right_area[bin_count];
+            int right_count[bin_count];
+            aabb acc;
+            int acc_count = 0;
+            for (int b = bin_count - 1; b > 0; b--) {
+                acc.expand(bin_bounds[b]);
+                acc_count += bin_counts[b];
+                right_area[b] = acc.surface_area();
+                right_count[b] = acc_count;
+            }
+
+            float best_cost = INFINITY;
+            int best_split = -1;
+            acc = aabb();
+            acc_count = 0;
+            for (int b = 1; b < bin_count; b++) {
+                acc.expand(bin_bounds[b - 1]);
+                acc_count += bin_counts[b - 1];
+                if (acc_count == 0 || right_count[b] == 0) continue;
+                float cost = prim_cost * (acc.surface_area() * acc_count + right_area[b] * right_count[b]);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_split = b;
+                }
+            }
+
+            float leaf_cost = prim_cost * count * bounds.surface_area();
+            float split_cost = bounds.surface_area() + best_cost;
+            if (count <= max_leaf_size && (best_split < 0 || leaf_cost <= split_cost)) return make_leaf();
+            if (best_split >= 0) {
+                auto it = std::partition(prims.begin() + begin, prims.begin() + end,
+                                         [&](const build_prim &p) { return bin_of(p) < best_split; });
+                mid = int(it - prims.begin());
+            } else {
+                median_split(prims, begin, end, axis, mid);
+            }
+        } else {
+            median_split(prims, begin, end, axis, mid);
+        }
+
+        stats.sah_cost += bounds.surface_area();
+        nodes[node_index].count = 0;
+        nodes[node_index].axis = (uint16_t)axis;
+        build_recursive(prims, begin, mid, depth + 1, max_leaf_size, prim_cost);
+        nodes[node_index].offset = build_recursive(prims, mid, end, depth + 1, max_leaf_size, prim_cost);
+        return node_index;
+    }
+
+    void median_split(std::vector<build_prim> &prims, int begin, int end, int axis, int mid) {
+        std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+                         [axis](const build_prim &a, const build_prim &b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+};
+
+// BVH over arbitrary hitables, a drop-in replacement for hitable_list as the world
+class bvh : public hitable {
+public:
+    std::vector<hitable *> objects; // reordered so each leaf is a contiguous run
+    bvh_tree tree;
+
+    bvh(hitable **l, int n) {
+        std::vector<aabb> bounds(n);
+        for (int i = 0; i < n; i++) l[i]->bounding_box(bounds[i]);
+        tree.build(bounds);
+        objects.resize(n);
+        for (int i = 0; i < n; i++) objects[i] = l[tree.prim_index[i]];
+    }
+
+    virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
+        return traverse<false>(r, t_min, t_max, rec, nullptr);
+    }
+
+    // same as hit() but counts visited nodes and primitive tests
+    bool hit_counted(const ray &r, float t_min, float t_max, hit_record &rec, bvh_traversal_stats &traversal) const {
+        traversal.rays++;
+        return traverse<true>(r, t_min, t_max, rec, &traversal);
+    }
+
+    virtual bool bounding_box(aabb &box) const {
+        box = tree.bounds();
+        return !objects.empty();
+    }
+
+    template <bool count_stats>
+    bool traverse(const ray &r, float t_min, float t_max, hit_record &rec, bvh_traversal_stats *traversal) const {
+        float closest_so_far = t_max;
+        return tree.intersect<count_stats>(r, t_min, closest_so_far, [&](int first, int count, float &closest) {
+            bool hit_anything = false;
+            RT_STAT(render_stats::local().prim_tests[prim_object] += count);
+            for (int i = first; i < first + count; i++) {
+                if (objects[i]->hit(r, t_min, closest, rec)) {
+                    closest = rec.t;
+                    hit_anything = true;
+                }
+            }
+            return hit_anything;
+        }, traversal);
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_BVH_H
@@ -2,12 +2,6 @@
 // Created by karan on 9/2/2025.
 //
 
-
-#include <random>
-std::random_device rd;
-std::mt19937 gen(rd()); // Mersenne Twister RNG
-std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
 #ifndef CPU_CPP_RAYTRACING_CAMERA_H
 #define CPU_CPP_RAYTRACING_CAMERA_H
 #include "ray.h"
@@ -20,12 +14,15 @@ public:
     vec3 horizontal;
     vec3 vertical;
     vec3 u, v, w;
+    vec3 vup;
+    float vfov, aspect;
+    float half_width, half_height;  // of the image plane, one unit in front of origin
 
-    camera(vec3 lookfrom, vec3 lookat, vec3 vup, float vfov, float aspect) {
+    camera(vec3 lookfrom, vec3 lookat, vec3 vup, float vfov, float aspect) : vup(vup), vfov(vfov), aspect(aspect) {
         // vfov = vertical field of view in degrees
         float theta = vfov * M_PI / 180.0f;
-        float half_height = tan(theta/2);
-        float half_width = aspect * half_height;
+        half_height = tan(theta/2);
+        half_width = aspect * half_height;
 
         origin = lookfrom;
         w = unit_vector(lookfrom - lookat); // forward
@@ -40,6 +37,26 @@ public:
     ray get_ray(float s, float t) {
         return ray(origin, lower_left_corner + s*horizontal + t*vertical - origin);
     }
+
+    // angle one of ny pixel rows covers, for ray cones
+    float pixel_spread(int ny) const { return 2 * half_height / ny; }
+
+    // the same lens somewhere else
+    camera moved(const vec3 &lookfrom, const vec3 &lookat) const {
+        return camera(lookfrom, lookat, vup, vfov, aspect);
+    }
+
+    // Inverse of get_ray: the (s, t) whose ray goes along direction d.
+    // False if d points behind the camera.
+    bool project_direction(const vec3 &d, float &s, float &t) const {
+        float z = -dot(d, w);
+        if (z <= 0) return false;
+        s = dot(d, u) / (z * 2 * half_width) + 0.5f;
+        t = dot(d, v) / (z * 2 * half_height) + 0.5f;
+        return true;
+    }
+
+    bool project(const vec3 &p, float &s, float &t) const { return project_direction(p - origin, s, t); }
 };
 
 #endif //CPU_CPP_RAYTRACING_CAMERA_H
@@ -0,0 +1,276 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_CHECKPOINT_H
+#define CPU_CPP_RAYTRACING_CHECKPOINT_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "film.h"
+#include "integrator.h"
+
+// Checkpoints of a progressive render: everything the film accumulates, in
+// a file that stays mapped shared for the whole render. A checkpoint copies
+// the film into the slot that does not hold the latest snapshot, then flips
+// the header to it and asks for an asynchronous write-back (msync MS_ASYNC);
+// there is no serialization buffer and no write() call, and the render
+// goes on while the kernel writes the pages out. A process crash while
+// copying leaves the previous slot intact, since the pages are the kernel's
+// once written. A power loss or OS crash is not covered: the kernel may
+// write the header before the slot, so the file can then name a torn slot.
+// Unix only: open() fails on Windows.
+//
+// Resuming restores the film exactly. Every sample's random numbers derive
+// from (pixel, sample index) and, with nothing reprojected (a camera move
+// ends checkpointing), the sample index is the pixel's sample count, so the
+// resumed render continues where it stopped and ends with the same image as
+// one that was never interrupted.
+
+struct checkpoint_slot {
+    int32_t samples_done;   // per-pixel samples of the passes that went into it
+    uint32_t generation;    // counts checkpoints, 0 = never written
+    double seconds;         // render time that went into it
+};
+
+struct checkpoint_header {
+    char magic[8];
+    uint32_t version;
+    int32_t nx, ny;
+    uint32_t active;            // slot with the latest snapshot, or no_slot
+    uint64_t key;               // what is being rendered, see render_key()
+    checkpoint_slot slots[2];
+};
+
+struct checkpoint_stats {
+    int written = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+    size_t file_bytes = 0;
+
+    void print(const char *path) const {
+        fprintf(stderr, "checkpoints: %d written to %s (%.1f MB), %.2f ms each on average, %.2f ms max\n", written,
+                path, file_bytes / 1e6, written ? total_ms / written : 0.0, max_ms);
+    }
+};
+
+// FNV-1a over everything that changes what a pixel's samples add up to:
+// the scene (whatever tells it apart, see scene_identity() in main.cpp) and
+// the render settings. Without adaptive sampling the pass size does not
+// matter, so a headless render can be resumed in the window and the other
+// way round.
+inline uint64_t render_key(const std::string &scene, const render_settings &settings) {
+    bool adaptive = settings.noise_threshold > 0;
+    char text[512];
+    int n = snprintf(text, sizeof(text), "%llu|%d|%d|%g|%g|%d|%d|%d|%d",
+                     (unsigned long long)settings.seed, int(settings.integrator), int(settings.bounces.russian_roulette),
+                     settings.bounces.rr_threshold, settings.noise_threshold, adaptive ? settings.min_samples : 0,
+                     adaptive ? settings.samples_per_pass : 0, int(settings.sampling),
+                     settings.sampling == sampler_stratified ? settings.sample_count : 0);
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void *data, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) hash = (hash ^ ((const unsigned char *)data)[i]) * 1099511628211ull;
+    };
+    mix(scene.data(), scene.size());
+    mix(text, std::min<size_t>(n, sizeof(text) - 1));
+    mix(settings.bounces.max_depth, sizeof(settings.bounces.max_depth));
+    mix(settings.bounces.min_depth, sizeof(settings.bounces.min_depth));
+    return hash;
+}
+
+class checkpoint_file {
+public:
+    checkpoint_stats stats;
+    double interval_seconds = 60;
+
+    checkpoint_file() = default;
+    checkpoint_file(const checkpoint_file &) = delete;
+    checkpoint_file &operator=(const checkpoint_file &) = delete;
+    ~checkpoint_file() { close(); }
+
+    // Maps path (created or resized as needed). With resume, an existing
+    // file for the same image size and key is kept and restore() can read
+    // it; otherwise the file starts out empty.
+    bool open(const std::string &file_path, int width, int height, uint64_t render, bool resume) {
+        close();
+        path = file_path;
+        nx = width;
+        ny = height;
+        key = render;
+        stats = checkpoint_stats();
+        last_save = std::chrono::steady_clock::now();
+
+#ifndef _WIN32
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "cannot open %s\n", path.c_str());
+            return false;
+        }
+        struct stat st;
+        bool existing = fstat(fd, &st) == 0 && size_t(st.st_size) == file_size();
+        if (!existing && ftruncate(fd, off_t(file_size())) != 0) {
+            fprintf(stderr, "cannot resize %s\n", path.c_str());
+            close();
+            return false;
+        }
+        void *p = mmap(nullptr, file_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "cannot map %s\n", path.c_str());
+            close();
+            return false;
+        }
+        mapping = (char *)p;
+        stats.file_bytes = file_size();
+#else
+        fprintf(stderr, "checkpoints need mmap, not available on this platform\n");
+        bool existing = false;
+        return false;
+#endif
+
+        checkpoint_header &h = header();
+        bool matches = existing && !memcmp(h.magic, magic, sizeof(magic)) && h.version == version && h.nx == nx &&
+                       h.ny == ny && h.key == key && h.active < 2;
+        if (resume && existing && !matches) {
+            fprintf(stderr, "%s is from a different render, starting over\n", path.c_str());
+        }
+        if (!resume || !matches) {
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, magic, sizeof(magic));
+            h.version = version;
+            h.nx = nx;
+            h.ny = ny;
+            h.key = key;
+            h.active = no_slot;
+        }
+        return true;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (mapping) {
+            msync(mapping, file_size(), MS_SYNC);
+            munmap(mapping, file_size());
+        }
+        if (fd >= 0) ::close(fd);
+#endif
+        mapping = nullptr;
+        fd = -1;
+    }
+
+    bool is_open() const { return mapping != nullptr; }
+
+    // the latest snapshot into image; false if there is none
+    bool restore(film &image, int &samples_done, double &seconds) const {
+        if (!mapping) return false;
+        const checkpoint_header &h = header();
+        if (h.active >= 2) return false;
+        const checkpoint_slot &slot = h.slots[h.active];
+        slot_arrays a = arrays(h.active);
+        size_t n = size_t(nx) * ny;
+        memcpy(image.sum.data(), a.sum, n * sizeof(vec3));
+        memcpy(image.lum_sq.data(), a.lum_sq, n * sizeof(float));
+        memcpy(image.samples.data(), a.samples, n * sizeof(int));
+        memcpy(image.converged.data(), a.converged, n);
+        for (size_t i = 0; i < n; i++) image.errors[i] = image.error(int(i));
+        samples_done = slot.samples_done;
+        seconds = slot.seconds;
+        return true;
+    }
+
+    // only between passes, while nothing writes to image
+    void save(const film &image, int samples_done, double seconds) {
+        if (!mapping) return;
+        auto start = std::chrono::steady_clock::now();
+        checkpoint_header &h = header();
+        uint32_t target = h.active == 0 ? 1 : 0;
+        slot_arrays a = arrays(target);
+        size_t n = size_t(nx) * ny;
+        memcpy(a.sum, image.sum.data(), n * sizeof(vec3));
+        memcpy(a.lum_sq, image.lum_sq.data(), n * sizeof(float));
+        memcpy(a.samples, image.samples.data(), n * sizeof(int));
+        memcpy(a.converged, image.converged.data(), n);
+        uint32_t generation = h.active < 2 ? h.slots[h.active].generation + 1 : 1;
+        h.slots[target] = {samples_done, generation, seconds};
+        std::atomic_thread_fence(std::memory_order_release);
+        h.active = target;      // the snapshot counts from here on
+#ifndef _WIN32
+        msync(mapping, file_size(), MS_ASYNC);
+#endif
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.written++;
+        stats.total_ms += ms;
+        stats.max_ms = std::max(stats.max_ms, ms);
+        last_save = std::chrono::steady_clock::now();
+    }
+
+    // the render starts over (the scene was reloaded): no snapshot until the next save
+    void discard() {
+        if (mapping) header().active = no_slot;
+    }
+
+    // true once interval_seconds have passed since the last save
+    bool due() const {
+        return mapping && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_save).count() >=
+                          interval_seconds;
+    }
+
+    const std::string &file_path() const { return path; }
+
+private:
+    static constexpr char magic[8] = {'R', 'T', 'C', 'K', 'P', 'T', 0, 0};
+    static const uint32_t version = 1;
+    static const uint32_t no_slot = 0xffffffff;
+
+    struct slot_arrays {
+        vec3 *sum;
+        float *lum_sq;
+        int *samples;
+        uint8_t *converged;
+    };
+
+    std::string path;
+    int nx = 0, ny = 0;
+    uint64_t key = 0;
+    int fd = -1;
+    char *mapping = nullptr;
+    std::chrono::steady_clock::time_point last_save;
+
+    static size_t align(size_t bytes) { return (bytes + 63) / 64 * 64; }
+
+    size_t slot_bytes() const {
+        size_t n = size_t(nx) * ny;
+        return align(n * sizeof(vec3)) + align(n * sizeof(float)) + align(n * sizeof(int)) + align(n);
+    }
+
+    size_t file_size() const { return align(sizeof(checkpoint_header)) + 2 * slot_bytes(); }
+
+    checkpoint_header &header() const { return *(checkpoint_header *)mapping; }
+
+    slot_arrays arrays(uint32_t slot) const {
+        size_t n = size_t(nx) * ny;
+        char *p = mapping + align(sizeof(checkpoint_header)) + slot * slot_bytes();
+        slot_arrays a;
+        a.sum = (vec3 *)p;
+        p += align(n * sizeof(vec3));
+        a.lum_sq = (float *)p;
+        p += align(n * sizeof(float));
+        a.samples = (int *)p;
+        p += align(n * sizeof(int));
+        a.converged = (uint8_t *)p;
+        return a;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_CHECKPOINT_H
@@ -4,12 +4,97 @@
 
 #ifndef CPU_CPP_RAYTRACING_COMMON_H
 #define CPU_CPP_RAYTRACING_COMMON_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "sampler.h"
 #include "vec3.h"
-vec3 random_in_unit_sphere() {
-    vec3 p;
-    do {
-        p = 2.0 * vec3(dist(gen),dist(gen),dist(gen)) - vec3(1, 1, 1);
-    } while (p.squared_length() >= 1.0);
-    return p;
-}
-#endif //CPU_CPP_RAYTRACING_COMMON_H
\ No newline at end of file
+
+// Warps from the unit square, direct rather than rejection sampled: a fixed
+// number of sampler dimensions per call and no data dependent loop, and
+// nearby points stay nearby, so stratified and low-discrepancy points keep
+// their spread after the warp.
+
+// sin and cos of a in [-pi/4, pi/4]: Taylor series, exact to float precision there
+inline void sin_cos_quarter(float a, float &sin_a, float &cos_a) {
+    float a2 = a * a;
+    sin_a = a * (1 + a2 * (-1.0f / 6 + a2 * (1.0f / 120 + a2 * (-1.0f / 5040))));
+    cos_a = 1 + a2 * (-0.5f + a2 * (1.0f / 24 + a2 * (-1.0f / 720 + a2 * (1.0f / 40320))));
+}
+
+// cos and sin of 2 pi u for u in [0, 1), from the nearest quarter turn
+inline void sin_cos_turn(float u, float &sin_phi, float &cos_phi) {
+    float quarters = 4 * u;
+    int q = int(quarters + 0.5f);
+    float s, c;
+    sin_cos_quarter((quarters - float(q)) * 1.57079633f, s, c);
+    switch (q & 3) {
+        case 0: sin_phi = s; cos_phi = c; break;
+        case 1: sin_phi = c; cos_phi = -s; break;
+        case 2: sin_phi = -s; cos_phi = -c; break;
+        default: sin_phi = -c; cos_phi = s; break;
+    }
+}
+
+// uniform on the unit sphere (Archimedes: z is uniform)
+inline vec3 sample_unit_sphere(point2 u) {
+    float z = 1 - 2 * u.x;
+    float r = std::sqrt(std::max(0.0f, 1 - z * z));
+    float sin_phi, cos_phi;
+    sin_cos_turn(u.y, sin_phi, cos_phi);
+    return vec3(r * cos_phi, r * sin_phi, z);
+}
+
+// uniform on the unit disk, concentric (Shirley and Chiu 1997): squares
+// around the center go to rings, which keeps strata compact. The two halves
+// of the square differ only in which coordinate is the radius, picked with
+// selects rather than a branch on the random point.
+inline point2 sample_concentric_disk(point2 u) {
+    float x = 2 * u.x - 1, y = 2 * u.y - 1;
+    if (x == 0 && y == 0) return {0, 0};
+    bool wide = std::fabs(x) > std::fabs(y);
+    float r = wide ? x : y;
+    float s, c;
+    // the angle is pi/4 y/x, or pi/2 - pi/4 x/y
+    sin_cos_quarter(0.78539816f * ((wide ? y : x) / r), s, c);
+    return {r * (wide ? c : s), r * (wide ? s : c)};
+}
+
+// Cosine-weighted about the unit vector n (pdf cos / pi): a disk point lifted
+// onto the hemisphere (Malley's method), in a basis around n that needs no
+// branch on its direction (Duff et al. 2017).
+inline vec3 sample_cosine_hemisphere(const vec3 &n, point2 u) {
+    float sign = std::copysign(1.0f, n.z());
+    float a = -1 / (sign + n.z());
+    float b = n.x() * n.y() * a;
+    vec3 t(1 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+    vec3 bt(b, sign + n.y() * n.y() * a, -n.y());
+    point2 d = sample_concentric_disk(u);
+    float z = std::sqrt(std::max(0.0f, 1 - d.x * d.x - d.y * d.y));
+    return d.x * t + d.y * bt + z * n;
+}
+
+// cube root of x in [0, 1]: a guess from the exponent bits, then two
+// Halley steps, each tripling the correct digits
+inline float cube_root(float x) {
+    if (!(x > 0)) return 0;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = bits / 3 + 709921077u;
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+    for (int k = 0; k < 2; k++) {
+        float y3 = y * y * y;
+        y *= (y3 + 2 * x) / (2 * y3 + x);
+    }
+    return y;
+}
+
+// uniform in the unit ball: a direction, and a radius with the cube root
+// (the volume inside radius r grows as r^3); three dimensions
+inline vec3 random_in_unit_sphere(sampler &s) {
+    point2 u = s.next_2d();
+    return cube_root(s.next_1d()) * sample_unit_sphere(u);
+}
+#endif //CPU_CPP_RAYTRACING_COMMON_H
@@ -5,6 +5,7 @@
 #ifndef CPU_CPP_RAYTRACING_CUBE_H
 #define CPU_CPP_RAYTRACING_CUBE_H
 #include "hitable.h"
+#include "simd.h"
 #include <algorithm>
 
 struct triangle {
@@ -46,25 +47,34 @@ const triangle unit_triangles[12] = {
     {vec3(-0.5f, 0.5f, -0.5f), vec3(0.5f, 0.5f, 0.5f), vec3(-0.5f, 0.5f, 0.5f), vec3(0,1,0)}
 };
 
+// the 12 unit triangles as 8 + 4 SIMD lanes
+struct unit_cube_packets {
+    triangle_packet packets[2] = {};
+    unit_cube_packets() {
+        for (int i = 0; i < 12; ++i) {
+            packets[i / packet_width].set(i % packet_width, unit_triangles[i].v0, unit_triangles[i].v1,
+                                          unit_triangles[i].v2);
+        }
+    }
+};
+const unit_cube_packets unit_cube;
+
+// An axis aligned cube. The geometry is unit_cube, shared by every cube:
+// the ray is moved into unit space instead (t stays the same along it), so
+// a cube only stores where it is and how big.
 class cube : public hitable {
 public:
     material *mat_ptr;
-    vec3 vertices[8];
-    triangle triangles[12];
+    vec3 position;
+    float size;
 
-    cube(const vec3 &position, float size, material *mat) {
-        mat_ptr = mat;
-        for (int i = 0; i < 8; ++i) {
-            vertices[i] = unit_vertices[i] * size + position;
-        }
-        for (int i = 0; i < 12; ++i) {
-            triangles[i].v0 = unit_triangles[i].v0 * size + position;
-            triangles[i].v1 = unit_triangles[i].v1 * size + position;
-            triangles[i].v2 = unit_triangles[i].v2 * size + position;
-            triangles[i].normal = unit_triangles[i].normal;
-        }
-    }
+    cube(const vec3 &position, float size, material *mat) : mat_ptr(mat), position(position), size(size) {}
     virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const;
+    virtual bool bounding_box(aabb &box) const {
+        vec3 half(0.5f * size, 0.5f * size, 0.5f * size);
+        box = aabb(position - half, position + half);
+        return true;
+    }
 };
 
 bool ray_triangle_intersect(const ray &r, const triangle &tri, float t_min, float t_max, float &t, vec3 &normal) {
@@ -94,15 +104,8 @@ bool ray_triangle_intersect(const ray &r, const triangle &tri, float t_min, floa
 
     t = inv_det * dot(edge2, qvec);
 
-    // vec3 p = r.point_at_parameter(t); // hit point
-
-
-
     if (t > t_min && t < t_max)
     {
-        // vec3 perlin_vec = vec3(ValueNoise_2D(x*500,y*500),ValueNoise_2D(x*500,y*500),ValueNoise_2D(x*500,y*500));
-        // perlin_vec.make_unit_vector();
-        // normal = tri.normal+perlin_vec;
         normal = tri.normal;
         return true;
     }
@@ -111,25 +114,24 @@ bool ray_triangle_intersect(const ray &r, const triangle &tri, float t_min, floa
 }
 
 bool cube::hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
+    ray local;
+    local.a = (r.a - position) / size;
+    local.b = r.b / size;
     float closest_t = t_max;
-    bool hit_anything = false;
-    vec3 hit_normal;
-
-    for (const auto &tri : this->triangles) {
-        float t;
-        vec3 normal;
-        if (ray_triangle_intersect(r, tri, t_min, closest_t, t, normal)) {
-            hit_anything = true;
-            closest_t = t;
-            hit_normal = normal;
-        }
-    }
+    int hit_index = -1;
+
+    int lane = simd.triangles(local, unit_cube.packets[0], 8, t_min, closest_t);
+    if (lane >= 0) hit_index = lane;
+    lane = simd.triangles(local, unit_cube.packets[1], 4, t_min, closest_t);
+    if (lane >= 0) hit_index = packet_width + lane;
 
-    if (hit_anything) {
+    if (hit_index >= 0) {
         rec.t = closest_t;
         rec.p = r.point_at_parameter(closest_t);
-        rec.normal = hit_normal;
+        const triangle &tri = unit_triangles[hit_index];
+        rec.normal = tri.normal;
         rec.mat_ptr = mat_ptr;
+        set_triangle_uv(tri.v0 * size + position, (tri.v1 - tri.v0) * size, (tri.v2 - tri.v0) * size, rec);
         return true;
     }
     return false;
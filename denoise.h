@@ -0,0 +1,403 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_DENOISE_H
+#define CPU_CPP_RAYTRACING_DENOISE_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "camera.h"
+#include "film.h"
+#include "hitable.h"
+#include "integrator.h"
+#include "material.h"
+#include "renderer.h"
+#include "resolve.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// First-hit auxiliary buffers, indexed like the film: what the camera sees
+// before any bounce. They come from a pass of their own, four primary rays
+// per pixel on a 2x2 grid, so edges are antialiased like the image and the
+// path integrators are untouched.
+struct feature_buffers {
+    int nx = 0, ny = 0;
+    std::vector<vec3> albedo;   // material::surface_albedo, 1 for the sky
+    std::vector<vec3> normal;   // facing the camera, towards the camera for the sky
+    std::vector<float> depth;   // distance along the ray, sky_depth for the sky
+
+    static constexpr float sky_depth = 1e20f;
+};
+
+void render_features(tile_scheduler &pool, hitable *world, camera &cam, int nx, int ny, feature_buffers &features) {
+    const int strata = 2;
+    features.nx = nx;
+    features.ny = ny;
+    features.albedo.resize(size_t(nx) * ny);
+    features.normal.resize(size_t(nx) * ny);
+    features.depth.resize(size_t(nx) * ny);
+    tile_grid grid(nx, ny);
+    pool.run(grid.count(), [&](int tile, int) {
+        int start_x, end_x, start_y, end_y;
+        grid.bounds(tile, start_x, end_x, start_y, end_y);
+        for (int j = start_y; j < end_y; j++) {
+            for (int i = start_x; i < end_x; i++) {
+                vec3 albedo(0, 0, 0), normal(0, 0, 0);
+                float depth = 0;
+                for (int k = 0; k < strata * strata; k++) {
+                    float u = (i + (k % strata + 0.5f) / strata) / nx;
+                    float v = (j + (k / strata + 0.5f) / strata) / ny;
+                    ray r = cam.get_ray(u, v);
+                    hit_record rec;
+                    if (world->hit(r, 0.001, INFINITY, rec)) {
+                        ray_cone{0, cam.pixel_spread(ny)}.reach(rec);
+                        albedo += rec.mat_ptr->surface_albedo(rec);
+                        normal += dot(rec.normal, r.direction()) > 0 ? -rec.normal : rec.normal;
+                        depth += rec.t * r.direction().length();
+                    } else {
+                        albedo += vec3(1, 1, 1);
+                        normal -= unit_vector(r.direction());
+                        depth += feature_buffers::sky_depth;
+                    }
+                }
+                int idx = (ny - 1 - j) * nx + i;
+                float weight = 1.0f / (strata * strata);
+                features.albedo[idx] = albedo * weight;
+                features.normal[idx] = normal * weight;
+                features.depth[idx] = depth * weight;
+            }
+        }
+    });
+}
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) with the
+// variance-guided luminance weight of SVGF (Schied et al. 2017). The
+// radiance is divided by the albedo first, so textures and material edges
+// are not blurred, and multiplied back at the end. Each of the iterations
+// applies the 5x5 B3 spline kernel with its taps 2^i pixels apart; a tap
+// counts less the more its luminance differs (relative to the pixel's
+// standard error, which comes from the film's squared luminance sums), the
+// more its normal turns away and the more its depth or albedo differ. The
+// variance is filtered along with the color, so the luminance weight
+// tightens as the image gets smoother.
+struct denoise_settings {
+    int iterations = 5;
+    float sigma_luminance = 4;      // in standard errors
+    float sigma_depth = 0.05f;      // relative depth difference per pixel of tap distance
+    float sigma_albedo = 0.1f;      // sum of absolute albedo differences
+};
+
+// The filter works on planes of floats and tap by tap over whole rows: for
+// a tap (dx, dy) the pixels that have it in the image are one contiguous
+// range, so the kernels below run 4 or 8 pixels at a time with plain loads,
+// picked by the --simd level like the resolve kernels.
+struct denoise_planes {
+    std::vector<float> r, g, b, var;
+
+    void resize(size_t n) {
+        for (std::vector<float> *p : {&r, &g, &b, &var}) p->resize(n);
+    }
+};
+
+// what one row of one iteration needs
+struct atrous_row {
+    int count;                  // pixels of the range
+    const float *r, *g, *b, *var;           // the tap's pixels
+    const float *nx, *ny, *nz, *depth, *ar, *ag, *ab;   // the tap's features
+    const float *p_lum, *p_nx, *p_ny, *p_nz, *p_depth, *p_ar, *p_ag, *p_ab;   // the center pixels'
+    const float *inv_sigma_lum;                         // the center pixels' luminance scale
+    float h;                    // kernel weight of the tap
+    float inv_sigma_depth;      // for this tap distance
+    float inv_sigma_albedo;
+    float *sum_w, *sum_r, *sum_g, *sum_b, *sum_var;     // accumulated per center pixel
+};
+
+typedef void (*atrous_tap_kernel)(const atrous_row &row);
+
+void atrous_tap_scalar(const atrous_row &row) {
+    for (int x = 0; x < row.count; x++) {
+        float lum = 0.2126f * row.r[x] + 0.7152f * row.g[x] + 0.0722f * row.b[x];
+        float e = std::fabs(row.p_lum[x] - lum) * row.inv_sigma_lum[x] +
+                  std::fabs(row.p_depth[x] - row.depth[x]) * row.inv_sigma_depth /
+                      std::min(row.p_depth[x], row.depth[x]) +
+                  (std::fabs(row.p_ar[x] - row.ar[x]) + std::fabs(row.p_ag[x] - row.ag[x]) +
+                   std::fabs(row.p_ab[x] - row.ab[x])) * row.inv_sigma_albedo;
+        // max(0, n.n')^128, by squaring
+        float n = std::max(row.p_nx[x] * row.nx[x] + row.p_ny[x] * row.ny[x] + row.p_nz[x] * row.nz[x], 0.0f);
+        for (int k = 0; k < 7; k++) n *= n;
+        float w = row.h * n * std::exp(-e);
+        row.sum_w[x] += w;
+        row.sum_r[x] += w * row.r[x];
+        row.sum_g[x] += w * row.g[x];
+        row.sum_b[x] += w * row.b[x];
+        row.sum_var[x] += w * w * row.var[x];
+    }
+}
+
+// the range from start on, for the kernels' tails
+inline atrous_row atrous_tail(const atrous_row &row, int start) {
+    atrous_row tail = row;
+    tail.count = row.count - start;
+    for (const float **p : {&tail.r, &tail.g, &tail.b, &tail.var, &tail.nx, &tail.ny, &tail.nz, &tail.depth, &tail.ar,
+                            &tail.ag, &tail.ab, &tail.p_lum, &tail.p_nx, &tail.p_ny, &tail.p_nz, &tail.p_depth,
+                            &tail.p_ar, &tail.p_ag, &tail.p_ab, &tail.inv_sigma_lum}) {
+        *p += start;
+    }
+    for (float **p : {&tail.sum_w, &tail.sum_r, &tail.sum_g, &tail.sum_b, &tail.sum_var}) *p += start;
+    return tail;
+}
+
+#ifdef RT_SIMD_X86
+// the weights only steer the filter, exp2_sse's accuracy is plenty
+void atrous_tap_sse(const atrous_row &row) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    auto abs_diff = [&](const float *a, const float *b, int x) {
+        return _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(a + x), _mm_loadu_ps(b + x)), abs_mask);
+    };
+    const __m128 minus_log2e = _mm_set1_ps(-1.44269504f);
+    int x = 0;
+    for (; x + 4 <= row.count; x += 4) {
+        __m128 r = _mm_loadu_ps(row.r + x), g = _mm_loadu_ps(row.g + x), b = _mm_loadu_ps(row.b + x);
+        __m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.2126f)), _mm_mul_ps(g, _mm_set1_ps(0.7152f))),
+                                _mm_mul_ps(b, _mm_set1_ps(0.0722f)));
+        __m128 e = _mm_mul_ps(_mm_and_ps(_mm_sub_ps(_mm_loadu_ps(row.p_lum + x), lum), abs_mask),
+                              _mm_loadu_ps(row.inv_sigma_lum + x));
+        __m128 depth = _mm_loadu_ps(row.depth + x), p_depth = _mm_loadu_ps(row.p_depth + x);
+        __m128 depth_diff = _mm_and_ps(_mm_sub_ps(p_depth, depth), abs_mask);
+        e = _mm_add_ps(e, _mm_div_ps(_mm_mul_ps(depth_diff, _mm_set1_ps(row.inv_sigma_depth)),
+                                     _mm_min_ps(p_depth, depth)));
+        __m128 albedo = _mm_add_ps(_mm_add_ps(abs_diff(row.p_ar, row.ar, x), abs_diff(row.p_ag, row.ag, x)),
+                                   abs_diff(row.p_ab, row.ab, x));
+        e = _mm_add_ps(e, _mm_mul_ps(albedo, _mm_set1_ps(row.inv_sigma_albedo)));
+        __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row.p_nx + x), _mm_loadu_ps(row.nx + x)),
+                                         _mm_mul_ps(_mm_loadu_ps(row.p_ny + x), _mm_loadu_ps(row.ny + x))),
+                              _mm_mul_ps(_mm_loadu_ps(row.p_nz + x), _mm_loadu_ps(row.nz + x)));
+        n = _mm_max_ps(n, _mm_setzero_ps());
+        for (int k = 0; k < 7; k++) n = _mm_mul_ps(n, n);
+        // exp2_sse flushes below 2^-126 to that, which the normal weight then scales
+        __m128 w = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(row.h), n), exp2_sse(_mm_mul_ps(e, minus_log2e)));
+        _mm_storeu_ps(row.sum_w + x, _mm_add_ps(_mm_loadu_ps(row.sum_w + x), w));
+        _mm_storeu_ps(row.sum_r + x, _mm_add_ps(_mm_loadu_ps(row.sum_r + x), _mm_mul_ps(w, r)));
+        _mm_storeu_ps(row.sum_g + x, _mm_add_ps(_mm_loadu_ps(row.sum_g + x), _mm_mul_ps(w, g)));
+        _mm_storeu_ps(row.sum_b + x, _mm_add_ps(_mm_loadu_ps(row.sum_b + x), _mm_mul_ps(w, b)));
+        _mm_storeu_ps(row.sum_var + x, _mm_add_ps(_mm_loadu_ps(row.sum_var + x),
+                                                  _mm_mul_ps(_mm_mul_ps(w, w), _mm_loadu_ps(row.var + x))));
+    }
+    if (x < row.count) atrous_tap_scalar(atrous_tail(row, x));
+}
+#endif
+
+#ifdef RT_SIMD_AVX2
+RT_TARGET_AVX2 void atrous_tap_avx2(const atrous_row &row) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    auto abs_diff = [&](const float *a, const float *b, int x) RT_TARGET_AVX2 {
+        return _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(a + x), _mm256_loadu_ps(b + x)), abs_mask);
+    };
+    const __m256 minus_log2e = _mm256_set1_ps(-1.44269504f);
+    int x = 0;
+    for (; x + 8 <= row.count; x += 8) {
+        __m256 r = _mm256_loadu_ps(row.r + x), g = _mm256_loadu_ps(row.g + x), b = _mm256_loadu_ps(row.b + x);
+        __m256 lum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(0.2126f)),
+                                                 _mm256_mul_ps(g, _mm256_set1_ps(0.7152f))),
+                                   _mm256_mul_ps(b, _mm256_set1_ps(0.0722f)));
+        __m256 e = _mm256_mul_ps(_mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(row.p_lum + x), lum), abs_mask),
+                                 _mm256_loadu_ps(row.inv_sigma_lum + x));
+        __m256 depth = _mm256_loadu_ps(row.depth + x), p_depth = _mm256_loadu_ps(row.p_depth + x);
+        __m256 depth_diff = _mm256_and_ps(_mm256_sub_ps(p_depth, depth), abs_mask);
+        e = _mm256_add_ps(e, _mm256_div_ps(_mm256_mul_ps(depth_diff, _mm256_set1_ps(row.inv_sigma_depth)),
+                                           _mm256_min_ps(p_depth, depth)));
+        __m256 albedo = _mm256_add_ps(_mm256_add_ps(abs_diff(row.p_ar, row.ar, x), abs_diff(row.p_ag, row.ag, x)),
+                                      abs_diff(row.p_ab, row.ab, x));
+        e = _mm256_add_ps(e, _mm256_mul_ps(albedo, _mm256_set1_ps(row.inv_sigma_albedo)));
+        __m256 n = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(row.p_nx + x), _mm256_loadu_ps(row.nx + x)),
+                          _mm256_mul_ps(_mm256_loadu_ps(row.p_ny + x), _mm256_loadu_ps(row.ny + x))),
+            _mm256_mul_ps(_mm256_loadu_ps(row.p_nz + x), _mm256_loadu_ps(row.nz + x)));
+        n = _mm256_max_ps(n, _mm256_setzero_ps());
+        for (int k = 0; k < 7; k++) n = _mm256_mul_ps(n, n);
+        __m256 w = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(row.h), n), exp2_avx(_mm256_mul_ps(e, minus_log2e)));
+        _mm256_storeu_ps(row.sum_w + x, _mm256_add_ps(_mm256_loadu_ps(row.sum_w + x), w));
+        _mm256_storeu_ps(row.sum_r + x, _mm256_add_ps(_mm256_loadu_ps(row.sum_r + x), _mm256_mul_ps(w, r)));
+        _mm256_storeu_ps(row.sum_g + x, _mm256_add_ps(_mm256_loadu_ps(row.sum_g + x), _mm256_mul_ps(w, g)));
+        _mm256_storeu_ps(row.sum_b + x, _mm256_add_ps(_mm256_loadu_ps(row.sum_b + x), _mm256_mul_ps(w, b)));
+        _mm256_storeu_ps(row.sum_var + x, _mm256_add_ps(_mm256_loadu_ps(row.sum_var + x),
+                                                        _mm256_mul_ps(_mm256_mul_ps(w, w),
+                                                                      _mm256_loadu_ps(row.var + x))));
+    }
+    if (x < row.count) atrous_tap_scalar(atrous_tail(row, x));
+}
+#endif
+
+atrous_tap_kernel atrous_tap_for(simd_level level) {
+    switch (level) {
+#ifdef RT_SIMD_AVX2
+        case simd_avx2: return atrous_tap_avx2;
+#endif
+#ifdef RT_SIMD_X86
+        case simd_sse: return atrous_tap_sse;
+#endif
+        default: return atrous_tap_scalar;
+    }
+}
+
+class denoiser {
+public:
+    denoise_settings settings;
+
+    // image's mean radiance, filtered with features (same size), into out:
+    // a film with one "sample" per pixel holding the result, so resolve()
+    // and resolve_linear() take it as they take any film
+    void run(tile_scheduler &pool, const film &image, const feature_buffers &features, film &out) {
+        int nx = image.nx, ny = image.ny;
+        size_t n = size_t(nx) * ny;
+        prepare(pool, image, features);
+
+        // ping-pong between current and next
+        atrous_tap_kernel kernel = atrous_tap_for(simd.level);
+        const float h[5] = {1 / 16.0f, 1 / 4.0f, 3 / 8.0f, 1 / 4.0f, 1 / 16.0f};
+        for (int it = 0; it < settings.iterations; it++) {
+            int step = 1 << it;
+            edge_scales(pool, nx, ny);
+            pool.run(ny, [&](int y, int worker) {
+                row_sums &acc = sums[worker];
+                acc.clear(nx);
+                size_t row = size_t(y) * nx;
+                for (int dy = -2; dy <= 2; dy++) {
+                    int qy = y + dy * step;
+                    if (qy < 0 || qy >= ny) continue;
+                    for (int dx = -2; dx <= 2; dx++) {
+                        int shift = dx * step;
+                        int x0 = std::max(0, -shift), x1 = std::min(nx, nx - shift);
+                        if (x0 >= x1) continue;
+                        size_t p = row + x0, q = size_t(qy) * nx + x0 + shift;
+                        atrous_row r;
+                        r.count = x1 - x0;
+                        r.r = &current.r[q]; r.g = &current.g[q]; r.b = &current.b[q]; r.var = &current.var[q];
+                        r.nx = &nrm_x[q]; r.ny = &nrm_y[q]; r.nz = &nrm_z[q]; r.depth = &depth[q];
+                        r.ar = &alb_r[q]; r.ag = &alb_g[q]; r.ab = &alb_b[q];
+                        r.p_lum = &lum[p];
+                        r.p_nx = &nrm_x[p]; r.p_ny = &nrm_y[p]; r.p_nz = &nrm_z[p]; r.p_depth = &depth[p];
+                        r.p_ar = &alb_r[p]; r.p_ag = &alb_g[p]; r.p_ab = &alb_b[p];
+                        r.inv_sigma_lum = &inv_sigma_lum[p];
+                        r.h = h[dx + 2] * h[dy + 2];
+                        r.inv_sigma_depth = 1 / (settings.sigma_depth * step * std::max({std::abs(dx), std::abs(dy), 1}));
+                        r.inv_sigma_albedo = 1 / settings.sigma_albedo;
+                        r.sum_w = &acc.w[x0]; r.sum_r = &acc.r[x0]; r.sum_g = &acc.g[x0]; r.sum_b = &acc.b[x0];
+                        r.sum_var = &acc.var[x0];
+                        kernel(r);
+                    }
+                }
+                // the center tap always has weight h(0)^2 > 0
+                for (int x = 0; x < nx; x++) {
+                    float inv = 1 / acc.w[x];
+                    next.r[row + x] = acc.r[x] * inv;
+                    next.g[row + x] = acc.g[x] * inv;
+                    next.b[row + x] = acc.b[x] * inv;
+                    next.var[row + x] = acc.var[x] * inv * inv;
+                }
+            });
+            std::swap(current, next);
+        }
+
+        // remodulate
+        out.nx = nx;
+        out.ny = ny;
+        out.sum.resize(n);
+        out.lum_sq.assign(n, 0.0f);
+        out.samples.assign(n, 1);
+        out.errors.assign(n, INFINITY);
+        out.converged.assign(n, 0);
+        pool.run(ny, [&](int y, int) {
+            for (size_t i = size_t(y) * nx; i < size_t(y + 1) * nx; i++) {
+                out.sum[i] = vec3(current.r[i] * alb_r[i], current.g[i] * alb_g[i], current.b[i] * alb_b[i]);
+            }
+        });
+    }
+
+private:
+    struct row_sums {
+        std::vector<float> w, r, g, b, var;
+
+        void clear(int n) {
+            for (std::vector<float> *p : {&w, &r, &g, &b, &var}) p->assign(n, 0.0f);
+        }
+    };
+
+    denoise_planes current, next;
+    std::vector<float> alb_r, alb_g, alb_b, nrm_x, nrm_y, nrm_z, depth;
+    std::vector<float> lum, inv_sigma_lum;
+    std::vector<row_sums> sums;     // per worker
+
+    static constexpr float min_albedo = 0.01f;
+
+    // demodulated radiance and its variance, and the features, as planes
+    void prepare(tile_scheduler &pool, const film &image, const feature_buffers &features) {
+        int nx = image.nx, ny = image.ny;
+        size_t n = size_t(nx) * ny;
+        current.resize(n);
+        next.resize(n);
+        for (std::vector<float> *p : {&alb_r, &alb_g, &alb_b, &nrm_x, &nrm_y, &nrm_z, &depth, &lum, &inv_sigma_lum}) {
+            p->resize(n);
+        }
+        sums.resize(pool.size());
+        pool.run(ny, [&](int y, int) {
+            for (size_t i = size_t(y) * nx; i < size_t(y + 1) * nx; i++) {
+                vec3 a = features.albedo[i];
+                alb_r[i] = std::max(a[0], min_albedo);
+                alb_g[i] = std::max(a[1], min_albedo);
+                alb_b[i] = std::max(a[2], min_albedo);
+                // unit length, so a pixel's own normal weight is 1
+                vec3 normal = features.normal[i].length() > 0 ? unit_vector(features.normal[i]) : vec3(0, 0, 1);
+                nrm_x[i] = normal[0];
+                nrm_y[i] = normal[1];
+                nrm_z[i] = normal[2];
+                depth[i] = features.depth[i];
+
+                vec3 c = image.mean(int(i));
+                current.r[i] = c[0] / alb_r[i];
+                current.g[i] = c[1] / alb_g[i];
+                current.b[i] = c[2] / alb_b[i];
+                // variance of the mean luminance, scaled like the demodulated color; with fewer than two
+                // samples there is no estimate and the luminance does not stop the filter
+                int samples = image.samples[i];
+                float variance = 1e6f;
+                if (samples >= 2) {
+                    float mean_l = luminance(image.sum[i]) / samples;
+                    variance = std::max(0.0f, (image.lum_sq[i] / samples - mean_l * mean_l) / (samples - 1));
+                }
+                float albedo_l = std::max(luminance(vec3(alb_r[i], alb_g[i], alb_b[i])), min_albedo);
+                current.var[i] = variance / (albedo_l * albedo_l);
+            }
+        });
+    }
+
+    // per iteration: each pixel's luminance and its luminance scale from the
+    // 3x3 blurred variance (a single pixel's estimate is noisy itself)
+    void edge_scales(tile_scheduler &pool, int nx, int ny) {
+        const float k[3] = {0.25f, 0.5f, 0.25f};
+        pool.run(ny, [&](int y, int) {
+            for (int x = 0; x < nx; x++) {
+                size_t i = size_t(y) * nx + x;
+                lum[i] = 0.2126f * current.r[i] + 0.7152f * current.g[i] + 0.0722f * current.b[i];
+                float variance = 0, weight = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    int yy = y + dy;
+                    if (yy < 0 || yy >= ny) continue;
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int xx = x + dx;
+                        if (xx < 0 || xx >= nx) continue;
+                        float w = k[dx + 1] * k[dy + 1];
+                        variance += w * current.var[size_t(yy) * nx + xx];
+                        weight += w;
+                    }
+                }
+                inv_sigma_lum[i] = 1 / (settings.sigma_luminance * std::sqrt(variance / weight) + 1e-4f);
+            }
+        });
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_DENOISE_H
@@ -0,0 +1,263 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_DISTRIBUTED_H
+#define CPU_CPP_RAYTRACING_DISTRIBUTED_H
+#ifndef _WIN32
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "camera.h"
+#include "film.h"
+#include "hitable.h"
+#include "integrator.h"
+#include "renderer.h"
+
+// Rendering across worker processes on one host. The coordinator forks the
+// workers once the scene is built, so each starts with the scene and camera
+// already in memory (shared copy-on-write), and talks to each over a unix
+// socket pair. The work is cut into jobs of one tile and a range of sample
+// indices. A worker renders a job with exactly the sample indices a single
+// process would use and sends back per-pixel sums, which the coordinator
+// adds into its film; the image depends on the seed, not on which worker
+// took which job.
+//
+// Every worker has up to jobs_in_flight jobs outstanding. When a worker's
+// socket closes (crash, kill -9) it is reaped and its outstanding jobs go
+// back to the front of the queue; with no workers left the coordinator
+// renders the rest itself.
+
+struct tile_job {
+    int32_t tile;
+    int32_t first_sample;   // per-pixel sample count before this job
+    int32_t samples;
+};
+
+// what film::merge takes, for one pixel
+struct pixel_sums {
+    float r, g, b;
+    float lum_sq;
+};
+
+struct distributed_stats {
+    int workers = 0;
+    int jobs = 0;
+    int workers_lost = 0;
+    int jobs_reassigned = 0;
+    int jobs_local = 0;     // rendered by the coordinator after losing every worker
+};
+
+bool read_full(int fd, void *data, size_t bytes) {
+    char *p = (char *)data;
+    while (bytes > 0) {
+        ssize_t n = read(fd, p, bytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+// no SIGPIPE when the other side is gone, just false
+bool write_full(int fd, const void *data, size_t bytes) {
+    const char *p = (const char *)data;
+    while (bytes > 0) {
+        ssize_t n = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+// Renders one job with scratch, a film of the image size of which only the
+// job's tile is touched, and returns the tile's sums row by row.
+void render_job(film &scratch, hitable *world, camera &cam, const render_settings &settings, const tile_grid &grid,
+                const tile_job &job, std::vector<pixel_sums> &sums) {
+    int start_x, end_x, start_y, end_y;
+    grid.bounds(job.tile, start_x, end_x, start_y, end_y);
+    for (int j = start_y; j < end_y; j++) {
+        for (int i = start_x; i < end_x; i++) {
+            int idx = (grid.ny - 1 - j) * grid.nx + i;
+            scratch.sum[idx] = vec3(0, 0, 0);
+            scratch.lum_sq[idx] = 0;
+            scratch.samples[idx] = job.first_sample;
+            scratch.converged[idx] = 0;
+        }
+    }
+    for (int s = 0; s < job.samples; s++) trace_tile(scratch, world, cam, start_x, end_x, start_y, end_y, settings);
+
+    sums.clear();
+    for (int j = start_y; j < end_y; j++) {
+        for (int i = start_x; i < end_x; i++) {
+            int idx = (grid.ny - 1 - j) * grid.nx + i;
+            sums.push_back({scratch.sum[idx][0], scratch.sum[idx][1], scratch.sum[idx][2], scratch.lum_sq[idx]});
+        }
+    }
+}
+
+void merge_job(film &image, const tile_grid &grid, const tile_job &job, const std::vector<pixel_sums> &sums) {
+    int start_x, end_x, start_y, end_y;
+    grid.bounds(job.tile, start_x, end_x, start_y, end_y);
+    size_t k = 0;
+    for (int j = start_y; j < end_y; j++) {
+        for (int i = start_x; i < end_x; i++, k++) {
+            image.merge((grid.ny - 1 - j) * grid.nx + i, vec3(sums[k].r, sums[k].g, sums[k].b), sums[k].lum_sq,
+                        job.samples);
+        }
+    }
+}
+
+size_t job_pixels(const tile_grid &grid, const tile_job &job) {
+    int start_x, end_x, start_y, end_y;
+    grid.bounds(job.tile, start_x, end_x, start_y, end_y);
+    return size_t(end_x - start_x) * (end_y - start_y);
+}
+
+// A worker answers every job with the job followed by its sums, until the
+// coordinator closes the socket. fail_after >= 0 makes it exit abruptly
+// after that many jobs, to exercise the reassignment.
+[[noreturn]] void worker_main(int fd, int nx, int ny, hitable *world, camera &cam, const render_settings &settings,
+                              int fail_after) {
+    film scratch(nx, ny);
+    tile_grid grid(nx, ny);
+    std::vector<pixel_sums> sums;
+    tile_job job;
+    for (int done = 0; read_full(fd, &job, sizeof(job)); done++) {
+        if (done == fail_after) _exit(3);
+        render_job(scratch, world, cam, settings, grid, job, sums);
+        if (!write_full(fd, &job, sizeof(job)) || !write_full(fd, sums.data(), sums.size() * sizeof(pixel_sums))) break;
+    }
+    _exit(0);
+}
+
+// spp samples per pixel in jobs of settings.samples_per_pass samples, into
+// image (which should be empty). Returns false if no worker could be started.
+bool render_distributed(film &image, hitable *world, camera &cam, const render_settings &settings, int spp,
+                        int num_workers, int fail_after, distributed_stats &stats) {
+    const int jobs_in_flight = 2;   // one rendering, one queued, per worker
+    tile_grid grid(image.nx, image.ny);
+    std::deque<tile_job> pending;
+    for (int first = 0; first < spp; first += settings.samples_per_pass) {
+        for (int tile = 0; tile < grid.count(); tile++) {
+            pending.push_back({tile, first, std::min(settings.samples_per_pass, spp - first)});
+        }
+    }
+    stats = distributed_stats();
+    stats.jobs = (int)pending.size();
+
+    struct worker {
+        pid_t pid;
+        int fd;     // -1 once lost
+        std::deque<tile_job> in_flight;
+    };
+    std::vector<worker> workers;
+    fflush(nullptr);    // or the children flush the parent's buffered output again
+    for (int w = 0; w < num_workers; w++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) break;
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(sv[0]);
+            for (const worker &other : workers) close(other.fd);    // so they see EOF when the coordinator closes
+            worker_main(sv[1], image.nx, image.ny, world, cam, settings, w == 0 ? fail_after : -1);
+        }
+        close(sv[1]);
+        if (pid < 0) {
+            close(sv[0]);
+            break;
+        }
+        workers.push_back({pid, sv[0], {}});
+    }
+    stats.workers = (int)workers.size();
+    if (workers.empty()) return false;
+
+    auto lose = [&](worker &w) {
+        close(w.fd);
+        w.fd = -1;
+        waitpid(w.pid, nullptr, 0);
+        stats.workers_lost++;
+        stats.jobs_reassigned += (int)w.in_flight.size();
+        fprintf(stderr, "\nworker %d lost, %zu jobs reassigned\n", int(w.pid), w.in_flight.size());
+        pending.insert(pending.begin(), w.in_flight.begin(), w.in_flight.end());
+        w.in_flight.clear();
+    };
+
+    std::vector<pixel_sums> sums;
+    std::vector<pollfd> fds;
+    std::vector<worker *> polled;
+    int done = 0;
+    while (true) {
+        for (worker &w : workers) {
+            while (w.fd >= 0 && (int)w.in_flight.size() < jobs_in_flight && !pending.empty()) {
+                if (!write_full(w.fd, &pending.front(), sizeof(tile_job))) {
+                    lose(w);
+                    break;
+                }
+                w.in_flight.push_back(pending.front());
+                pending.pop_front();
+            }
+        }
+
+        fds.clear();
+        polled.clear();
+        for (worker &w : workers) {
+            if (w.fd < 0 || w.in_flight.empty()) continue;
+            fds.push_back({w.fd, POLLIN, 0});
+            polled.push_back(&w);
+        }
+        if (fds.empty()) break;     // done, or every worker lost
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t k = 0; k < fds.size(); k++) {
+            if (!fds[k].revents) continue;
+            worker &w = *polled[k];
+            tile_job job;
+            const tile_job &expected = w.in_flight.front();     // answers come in order
+            sums.resize(job_pixels(grid, expected));
+            if (!read_full(w.fd, &job, sizeof(job)) || job.tile != expected.tile ||
+                job.first_sample != expected.first_sample ||
+                !read_full(w.fd, sums.data(), sums.size() * sizeof(pixel_sums))) {
+                lose(w);
+                continue;
+            }
+            merge_job(image, grid, job, sums);
+            w.in_flight.pop_front();
+            // progress once per image worth of jobs
+            if (++done % grid.count() == 0 || done == stats.jobs) fprintf(stderr, "\rjobs done: %d/%d", done, stats.jobs);
+        }
+    }
+
+    if (!pending.empty()) {
+        fprintf(stderr, "\nno workers left, rendering the remaining %zu jobs here\n", pending.size());
+        film scratch(image.nx, image.ny);
+        for (const tile_job &job : pending) {
+            render_job(scratch, world, cam, settings, grid, job, sums);
+            merge_job(image, grid, job, sums);
+            stats.jobs_local++;
+        }
+    }
+    for (worker &w : workers) {
+        if (w.fd < 0) continue;
+        close(w.fd);    // the worker sees EOF and exits
+        waitpid(w.pid, nullptr, 0);
+    }
+    fprintf(stderr, "\n");
+    return true;
+}
+
+#endif
+#endif //CPU_CPP_RAYTRACING_DISTRIBUTED_H
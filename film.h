@@ -0,0 +1,111 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_FILM_H
+#define CPU_CPP_RAYTRACING_FILM_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "vec3.h"
+
+inline float luminance(const vec3 &c) {
+    return 0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2];
+}
+
+// Per-pixel sample accumulation, indexed like the output image
+// ((ny - 1 - j) * nx + i, top row first). Every pixel keeps its own sample
+// count, so pixels that have converged can stop taking samples.
+struct film {
+    int nx = 0, ny = 0;
+    std::vector<vec3> sum;          // radiance
+    std::vector<float> lum_sq;      // squared luminance, for the variance
+    std::vector<int> samples;
+    std::vector<float> errors;      // error() as of the last sample
+    std::vector<uint8_t> converged;
+    std::vector<int> first_index;   // sample index of the first of samples, moved on by reprojection
+
+    film(int width, int height) : nx(width), ny(height) { clear(); }
+
+    void clear() {
+        size_t n = size_t(nx) * ny;
+        sum.assign(n, vec3(0, 0, 0));
+        lum_sq.assign(n, 0.0f);
+        samples.assign(n, 0);
+        errors.assign(n, INFINITY);
+        converged.assign(n, 0);
+        first_index.assign(n, 0);
+    }
+
+    void add(int idx, const vec3 &c) {
+        float l = luminance(c);
+        sum[idx] += c;
+        lum_sq[idx] += l * l;
+        samples[idx]++;
+        errors[idx] = error(idx);
+    }
+
+    // n samples taken elsewhere (another process), as their sums
+    void merge(int idx, const vec3 &radiance_sum, float lum_sq_sum, int n) {
+        sum[idx] += radiance_sum;
+        lum_sq[idx] += lum_sq_sum;
+        samples[idx] += n;
+        errors[idx] = error(idx);
+    }
+
+    // A pixel stops once it has min_samples and the largest error in its
+    // 3x3 neighbourhood is below threshold. A single pixel's estimate is
+    // too optimistic when a rare bright path (a highlight through the glass)
+    // has not shown up yet; its neighbours usually have seen one.
+    // x, y are film coordinates (row y = 0 at the top).
+    void update_converged(int x, int y, float threshold, int min_samples) {
+        int idx = y * nx + x;
+        if (converged[idx] || samples[idx] < min_samples) return;
+        float worst = 0;
+        for (int yy = std::max(0, y - 1); yy <= std::min(ny - 1, y + 1); yy++) {
+            for (int xx = std::max(0, x - 1); xx <= std::min(nx - 1, x + 1); xx++) {
+                worst = std::max(worst, errors[yy * nx + xx]);
+            }
+        }
+        converged[idx] = worst < threshold;
+    }
+
+    // for the sampler: never one that went into the pixel's sum before
+    uint32_t sample_index(int idx) const { return uint32_t(first_index[idx] + samples[idx]); }
+
+    vec3 mean(int idx) const {
+        return samples[idx] ? sum[idx] / float(samples[idx]) : vec3(0, 0, 0);
+    }
+
+    // Standard error of the mean luminance, converted to display units: the
+    // image is shown with gamma 2, where a luminance error dL becomes
+    // dL / (2 sqrt(L)). 1/255 is then about one 8-bit step.
+    float error(int idx) const {
+        int n = samples[idx];
+        if (n < 2) return INFINITY;
+        float mean_l = luminance(sum[idx]) / n;
+        float variance = std::max(0.0f, (lum_sq[idx] / n - mean_l * mean_l) * n / (n - 1));
+        return std::sqrt(variance / n) / (2 * std::sqrt(std::max(mean_l, 1e-4f)));
+    }
+
+    size_t total_samples() const {
+        size_t total = 0;
+        for (int s : samples) total += s;
+        return total;
+    }
+
+    // samples per pixel as a blue (fewest) to red (most) ramp
+    std::vector<vec3> heatmap() const {
+        int most = std::max(1, *std::max_element(samples.begin(), samples.end()));
+        std::vector<vec3> image(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            float t = float(samples[i]) / most;
+            image[i] = vec3(t, 4 * t * (1 - t), 1 - t);
+            image[i] *= image[i];   // undo the gamma of the 8-bit writers
+        }
+        return image;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_FILM_H
@@ -4,9 +4,14 @@
 
 #ifndef CPU_CPP_RAYTRACING_HITABLE_H
 #define CPU_CPP_RAYTRACING_HITABLE_H
+#include <algorithm>
+#include <cmath>
+
+#include "aabb.h"
 #include "ray.h"
 #include "vec3.h"
 
+class light_list;
 class material;
 
 struct hit_record {
@@ -14,11 +19,55 @@ struct hit_record {
     vec3 p;
     vec3 normal;
     material *mat_ptr;
+    // texture coordinates; spheres leave them to surface_uv(), which works
+    // them out from the normal only for the hits a texture looks at
+    float u = 0, v = 0;
+    bool spherical_uv = false;
+    float uv_length = 0;    // world length per unit of u and v (square root of the area ratio)
+    float footprint = 0;    // width of the ray's cone at the hit, set by the integrator
+    bool listed_light = false;  // an emitter here is in the world's lights() too (scene packets and instances)
 };
 
+inline void set_sphere_uv(float radius, hit_record &rec) {
+    rec.spherical_uv = true;
+    rec.uv_length = radius * 3.5449077f;   // sqrt(4 pi)
+}
+
+// Barycentric coordinates of rec.p as (u, v), the weights of v0 + e1 and
+// v0 + e2: a triangle without its own coordinates gets the lower right half
+// of the unit square.
+inline void set_triangle_uv(const vec3 &v0, const vec3 &e1, const vec3 &e2, hit_record &rec) {
+    vec3 d = rec.p - v0;
+    float d00 = dot(e1, e1), d01 = dot(e1, e2), d11 = dot(e2, e2);
+    float d20 = dot(d, e1), d21 = dot(d, e2);
+    float inv = 1 / (d00 * d11 - d01 * d01);
+    float b1 = (d11 * d20 - d01 * d21) * inv, b2 = (d00 * d21 - d01 * d20) * inv;
+    rec.u = b1 + b2;
+    rec.v = b2;
+    rec.spherical_uv = false;
+    rec.uv_length = std::sqrt(cross(e1, e2).length());
+}
+
+// longitude and latitude on a sphere, v = 1 at the top
+inline void surface_uv(const hit_record &rec, float &u, float &v) {
+    if (!rec.spherical_uv) {
+        u = rec.u;
+        v = rec.v;
+        return;
+    }
+    const float pi = float(M_PI);
+    u = 0.5f + std::atan2(rec.normal.z(), rec.normal.x()) / (2 * pi);
+    v = 0.5f + std::asin(std::clamp(rec.normal.y(), -1.0f, 1.0f)) / pi;
+}
+
 class hitable {
 public:
+    virtual ~hitable() = default;
     virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const = 0;
+    // false if the object has no finite bounds
+    virtual bool bounding_box(aabb &box) const = 0;
+    // the emissive primitives to sample directly, if the world keeps a list
+    virtual const light_list *lights() const { return nullptr; }
 };
 
 #endif //CPU_CPP_RAYTRACING_HITABLE_H
\ No newline at end of file
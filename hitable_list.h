@@ -4,32 +4,76 @@
 
 #ifndef CPU_CPP_RAYTRACING_HITABLE_LIST_H
 #define CPU_CPP_RAYTRACING_HITABLE_LIST_H
+#include <vector>
 #include "hitable.h"
+#include "simd.h"
+#include "sphere.h"
 
 class hitable_list: public hitable {
 public:
     hitable **list;
     int list_size;
+    // spheres are tested 8 at a time from packets, everything else one by one
+    std::vector<sphere_packet> sphere_packets;
+    std::vector<const sphere*> packed_spheres;
+    std::vector<hitable*> others;
     hitable_list() = default;
     hitable_list(hitable **l, int n) {
         list = l;
         list_size = n;
+        for (int i = 0; i < n; i++) {
+            if (const sphere *s = dynamic_cast<const sphere*>(l[i])) {
+                int lane = (int)packed_spheres.size() % packet_width;
+                if (lane == 0) sphere_packets.push_back({});
+                sphere_packets.back().set(lane, s->center, s->radius);
+                packed_spheres.push_back(s);
+            } else {
+                others.push_back(l[i]);
+            }
+        }
     }
     virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const;
+    virtual bool bounding_box(aabb& box) const;
 };
 
 bool hitable_list::hit(const ray& r, float t_min, float t_max, hit_record& rec) const {
     hit_record temp_rec;
     bool hit_anything = false;
-    double closest_so_far = t_max;
-    for (int i = 0; i < list_size; i++) {
-        if (list[i]->hit(r, t_min, closest_so_far, temp_rec)) {
+    float closest_so_far = t_max;
+    int hit_sphere = -1;
+    for (size_t p = 0; p < sphere_packets.size(); p++) {
+        int count = std::min<int>(packet_width, (int)(packed_spheres.size() - p * packet_width));
+        int lane = simd.spheres(r, sphere_packets[p], count, t_min, closest_so_far);
+        if (lane >= 0) hit_sphere = int(p * packet_width + lane);
+    }
+    for (hitable *h : others) {
+        if (h->hit(r, t_min, closest_so_far, temp_rec)) {
             hit_anything = true;
+            hit_sphere = -1;
             closest_so_far = temp_rec.t;
             rec = temp_rec;
         }
     }
+    if (hit_sphere >= 0) {
+        const sphere *s = packed_spheres[hit_sphere];
+        rec.t = closest_so_far;
+        rec.p = r.point_at_parameter(rec.t);
+        rec.normal = (rec.p - s->center) / s->radius;
+        rec.mat_ptr = s->mat_ptr;
+        set_sphere_uv(s->radius, rec);
+        return true;
+    }
     return hit_anything;
 }
 
+bool hitable_list::bounding_box(aabb& box) const {
+    box = aabb();
+    for (int i = 0; i < list_size; i++) {
+        aabb child;
+        if (!list[i]->bounding_box(child)) return false;
+        box.expand(child);
+    }
+    return list_size > 0;
+}
+
 #endif //CPU_CPP_RAYTRACING_HITABLE_LIST_H
\ No newline at end of file
@@ -0,0 +1,311 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_IMAGE_IO_H
+#define CPU_CPP_RAYTRACING_IMAGE_IO_H
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "vec3.h"
+
+// same memory layout as raylib's Color, so the window can upload it directly
+struct rgba8 {
+    unsigned char r, g, b, a;
+};
+
+// plain gamma 2 conversion, for images that do not come from the film (see resolve.h)
+rgba8 to_rgba8(const vec3 &linear) {
+    vec3 c = vec3(sqrt(linear[0]), sqrt(linear[1]), sqrt(linear[2])) * 255.99f;
+    return {
+        (unsigned char)std::clamp(c[0], 0.0f, 255.0f),
+        (unsigned char)std::clamp(c[1], 0.0f, 255.0f),
+        (unsigned char)std::clamp(c[2], 0.0f, 255.0f),
+        255
+    };
+}
+
+void put_u32_be(std::vector<unsigned char> &out, uint32_t v) {
+    out.push_back((v >> 24) & 0xff);
+    out.push_back((v >> 16) & 0xff);
+    out.push_back((v >> 8) & 0xff);
+    out.push_back(v & 0xff);
+}
+
+void put_le(std::vector<unsigned char> &out, const void *data, size_t n) {
+    const unsigned char *p = (const unsigned char *)data;
+    out.insert(out.end(), p, p + n);
+}
+
+void put_attr(std::vector<unsigned char> &out, const char *name, const char *type, const void *data, int32_t size) {
+    put_le(out, name, strlen(name) + 1);
+    put_le(out, type, strlen(type) + 1);
+    put_le(out, &size, 4);
+    put_le(out, data, size);
+}
+
+uint32_t crc32(const unsigned char *data, size_t n, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+bool write_file(const std::string &path, const std::vector<unsigned char> &bytes) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return fclose(f) == 0 && ok;
+}
+
+// images are passed top row first, the same order the window texture uses
+bool write_ppm(const std::string &path, const std::vector<rgba8> &pixels, int nx, int ny) {
+    std::string header = "P6\n" + std::to_string(nx) + " " + std::to_string(ny) + "\n255\n";
+    std::vector<unsigned char> bytes(header.begin(), header.end());
+    bytes.reserve(bytes.size() + size_t(nx) * ny * 3);
+    for (const rgba8 &p : pixels) {
+        bytes.push_back(p.r);
+        bytes.push_back(p.g);
+        bytes.push_back(p.b);
+    }
+    return write_file(path, bytes);
+}
+
+// uncompressed PNG: zlib stream made of stored deflate blocks, so no zlib dependency
+bool write_png(const std::string &path, const std::vector<rgba8> &pixels, int nx, int ny) {
+    std::vector<unsigned char> raw;
+    raw.reserve(size_t(ny) * (nx * 3 + 1));
+    for (int j = 0; j < ny; j++) {
+        raw.push_back(0); // filter: none
+        for (int i = 0; i < nx; i++) {
+            const rgba8 &p = pixels[size_t(j) * nx + i];
+            raw.push_back(p.r);
+            raw.push_back(p.g);
+            raw.push_back(p.b);
+        }
+    }
+
+    std::vector<unsigned char> z = {0x78, 0x01};
+    size_t pos = 0;
+    do {
+        size_t len = std::min<size_t>(raw.size() - pos, 65535);
+        z.push_back(pos + len == raw.size() ? 1 : 0);
+        z.push_back(len & 0xff);
+        z.push_back(len >> 8);
+        z.push_back(~len & 0xff);
+        z.push_back((~len >> 8) & 0xff);
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32_be(z, (b << 16) | a);
+
+    std::vector<unsigned char> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    auto chunk = [&out](const char *type, const std::vector<unsigned char> &data) {
+        put_u32_be(out, data.size());
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put_u32_be(out, crc32(out.data() + start, out.size() - start));
+    };
+    std::vector<unsigned char> ihdr;
+    put_u32_be(ihdr, nx);
+    put_u32_be(ihdr, ny);
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, no interlace
+    chunk("IHDR", ihdr);
+    chunk("IDAT", z);
+    chunk("IEND", {});
+    return write_file(path, out);
+}
+
+// little endian portable float map, rows stored bottom to top
+bool write_pfm(const std::string &path, const std::vector<vec3> &linear, int nx, int ny) {
+    std::string header = "PF\n" + std::to_string(nx) + " " + std::to_string(ny) + "\n-1.0\n";
+    std::vector<unsigned char> bytes(header.begin(), header.end());
+    for (int j = ny - 1; j >= 0; j--) {
+        put_le(bytes, &linear[size_t(j) * nx], sizeof(float) * 3 * nx);
+    }
+    return write_file(path, bytes);
+}
+
+// single part scanline OpenEXR, 32 bit float channels, no compression
+bool write_exr(const std::string &path, const std::vector<vec3> &linear, int nx, int ny) {
+    std::vector<unsigned char> out = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+
+    std::vector<unsigned char> chlist;
+    for (const char *name : {"B", "G", "R"}) { // channels are sorted by name
+        chlist.push_back(name[0]);
+        chlist.push_back(0);
+        int32_t desc[4] = {2, 0, 1, 1}; // FLOAT, pLinear + reserved, x/y sampling
+        put_le(chlist, desc, sizeof(desc));
+    }
+    chlist.push_back(0);
+    put_attr(out, "channels", "chlist", chlist.data(), chlist.size());
+    unsigned char zero = 0;
+    put_attr(out, "compression", "compression", &zero, 1);
+    int32_t window[4] = {0, 0, nx - 1, ny - 1};
+    put_attr(out, "dataWindow", "box2i", window, sizeof(window));
+    put_attr(out, "displayWindow", "box2i", window, sizeof(window));
+    put_attr(out, "lineOrder", "lineOrder", &zero, 1);
+    float aspect = 1.0f;
+    put_attr(out, "pixelAspectRatio", "float", &aspect, 4);
+    float center[2] = {0.0f, 0.0f};
+    put_attr(out, "screenWindowCenter", "v2f", center, sizeof(center));
+    float width = 1.0f;
+    put_attr(out, "screenWindowWidth", "float", &width, 4);
+    out.push_back(0);
+
+    int32_t line_bytes = nx * 3 * sizeof(float);
+    uint64_t offset = out.size() + sizeof(uint64_t) * ny;
+    for (int j = 0; j < ny; j++) {
+        put_le(out, &offset, 8);
+        offset += 8 + line_bytes;
+    }
+    std::vector<float> line(nx * 3);
+    for (int32_t j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            const vec3 &c = linear[size_t(j) * nx + i];
+            line[i] = c[2];
+            line[nx + i] = c[1];
+            line[2 * nx + i] = c[0];
+        }
+        put_le(out, &j, 4);
+        put_le(out, &line_bytes, 4);
+        put_le(out, line.data(), line_bytes);
+    }
+    return write_file(path, out);
+}
+
+bool has_extension(const std::string &path, const char *ext) {
+    size_t n = strlen(ext);
+    if (path.size() < n) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (tolower(path[path.size() - n + i]) != ext[i]) return false;
+    }
+    return true;
+}
+
+bool is_hdr_format(const std::string &path) {
+    return has_extension(path, ".pfm") || has_extension(path, ".exr");
+}
+
+// picks the format from the file extension: the HDR formats store linear
+// radiance, the 8 bit ones the already tone mapped display pixels
+bool write_image(const std::string &path, const std::vector<vec3> &linear, const std::vector<rgba8> &display,
+                 int nx, int ny) {
+    if (has_extension(path, ".pfm")) return write_pfm(path, linear, nx, ny);
+    if (has_extension(path, ".exr")) return write_exr(path, linear, nx, ny);
+    if (has_extension(path, ".ppm")) return write_ppm(path, display, nx, ny);
+    if (has_extension(path, ".png")) return write_png(path, display, nx, ny);
+    fprintf(stderr, "unknown image format: %s (use .ppm, .png, .pfm or .exr)\n", path.c_str());
+    return false;
+}
+
+// same, with to_rgba8 for the 8 bit formats
+bool write_image(const std::string &path, const std::vector<vec3> &linear, int nx, int ny) {
+    std::vector<rgba8> pixels;
+    if (!is_hdr_format(path)) {
+        pixels.resize(linear.size());
+        for (size_t i = 0; i < linear.size(); i++) pixels[i] = to_rgba8(linear[i]);
+    }
+    return write_image(path, linear, pixels, nx, ny);
+}
+
+bool read_file(const std::string &path, std::vector<unsigned char> &bytes) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    bytes.clear();
+    unsigned char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// the next whitespace separated header field of a PPM/PFM, skipping comments;
+// leaves pos just past the single whitespace that ends it
+std::string next_header_field(const std::vector<unsigned char> &bytes, size_t &pos) {
+    while (pos < bytes.size()) {
+        if (bytes[pos] == '#') {
+            while (pos < bytes.size() && bytes[pos] != '\n') pos++;
+        } else if (isspace(bytes[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    std::string field;
+    while (pos < bytes.size() && !isspace(bytes[pos])) field += char(bytes[pos++]);
+    pos++;
+    return field;
+}
+
+// Reads a binary PPM (8 bit, gamma 2 like to_rgba8) or a PFM into linear
+// colors, top row first. These are the formats write_image produces without
+// a decoder dependency.
+bool read_image(const std::string &path, std::vector<vec3> &linear, int &nx, int &ny) {
+    std::vector<unsigned char> bytes;
+    if (!read_file(path, bytes)) {
+        fprintf(stderr, "cannot read %s\n", path.c_str());
+        return false;
+    }
+    size_t pos = 0;
+    std::string magic = next_header_field(bytes, pos);
+    nx = atoi(next_header_field(bytes, pos).c_str());
+    ny = atoi(next_header_field(bytes, pos).c_str());
+    std::string range = next_header_field(bytes, pos);
+    size_t count = size_t(std::max(nx, 0)) * std::max(ny, 0);
+    bool ppm = magic == "P6" && range == "255";
+    bool pfm = (magic == "PF" || magic == "Pf") && !range.empty();
+    int channels = magic == "Pf" ? 1 : 3;
+    size_t payload = ppm ? count * 3 : count * channels * sizeof(float);
+    if ((!ppm && !pfm) || count == 0 || pos + payload > bytes.size()) {
+        fprintf(stderr, "%s: not an 8 bit binary PPM or a PFM\n", path.c_str());
+        return false;
+    }
+    linear.resize(count);
+    const unsigned char *data = bytes.data() + pos;
+    if (ppm) {
+        for (size_t i = 0; i < count; i++) {
+            vec3 c(data[3 * i], data[3 * i + 1], data[3 * i + 2]);
+            linear[i] = c * c / (255.0f * 255.0f);
+        }
+        return true;
+    }
+    // rows bottom to top, little endian for a negative scale
+    bool little = atof(range.c_str()) < 0;
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            float c[3];
+            for (int k = 0; k < 3; k++) {
+                const unsigned char *b = data + ((size_t(j) * nx + i) * channels + (k % channels)) * 4;
+                uint32_t bits = little ? b[0] | b[1] << 8 | b[2] << 16 | uint32_t(b[3]) << 24
+                                       : b[3] | b[2] << 8 | b[1] << 16 | uint32_t(b[0]) << 24;
+                memcpy(&c[k], &bits, 4);
+            }
+            linear[size_t(ny - 1 - j) * nx + i] = vec3(c[0], c[1], c[2]);
+        }
+    }
+    return true;
+}
+
+#endif //CPU_CPP_RAYTRACING_IMAGE_IO_H
@@ -0,0 +1,493 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_IMAGE_TEXTURE_H
+#define CPU_CPP_RAYTRACING_IMAGE_TEXTURE_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "hitable.h"
+#include "image_io.h"
+#include "mapped_file.h"
+#include "texture.h"
+#include "vec3.h"
+
+// Image textures with mip maps, stored tiled and read through a bounded
+// cache.
+//
+// On disk, FILE.tiles next to the source image (built on first use, rebuilt
+// when the image changes, like a scene's FILE.bin) holds the whole mip
+// pyramid, box filtered in linear color down to 1x1, cut into 32x32 tiles
+// of gamma 2 rgba8 texels: 4 KB per tile, texels in Morton order inside a
+// tile. The texels of a bilinear footprint are nearly always in one tile and
+// mostly in one cache line, whichever direction the ray came from.
+//
+// In memory, one texture_cache holds a fixed number of tiles for all image
+// textures. Tiles are read from their files on first use and evicted with
+// the clock algorithm, so memory stays at the cache size however many
+// gigabytes of textures the scene has; a texture itself only keeps 4 bytes
+// per tile (which slot has it).
+//
+// Cached lookups take no lock. Every slot has a generation counter that is
+// odd while the slot is refilled (a sequence lock): a reader checks the slot
+// still holds its tile, copies the texels and retries if the generation
+// moved meanwhile. Misses take the cache lock only to pick a victim; the
+// read itself happens outside it.
+
+const int texture_tile_size = 32;   // texels per side
+const int texture_tile_texels = texture_tile_size * texture_tile_size;
+const int texture_tile_bytes = texture_tile_texels * 4;
+const int texture_max_levels = 24;
+
+// x and y below 2^16 interleaved, x in the even bits
+inline uint32_t morton2(uint32_t x, uint32_t y) {
+    auto spread = [](uint32_t v) {
+        v = (v | (v << 8)) & 0x00ff00ffu;
+        v = (v | (v << 4)) & 0x0f0f0f0fu;
+        v = (v | (v << 2)) & 0x33333333u;
+        return (v | (v << 1)) & 0x55555555u;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+struct tiled_level {
+    uint32_t width, height;
+    uint32_t tiles_x, tiles_y;
+    uint64_t first_tile;        // the tiles of the finer levels come first
+};
+
+struct tiled_texture_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t tile_size;
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t tile_count;
+    tiled_level level[texture_max_levels];
+    char source[2048];          // file_stamp() of the image it was made from
+};
+static_assert(sizeof(tiled_texture_header) <= texture_tile_bytes, "the header fits in front of the first tile");
+
+const char tiled_texture_magic[8] = {'R', 'T', 'T', 'I', 'L', 'E', 'S', 0};
+const uint32_t tiled_texture_version = 1;
+
+inline uint32_t pack_texel(const vec3 &linear) {
+    rgba8 c = to_rgba8(linear);
+    return uint32_t(c.r) | uint32_t(c.g) << 8 | uint32_t(c.b) << 16 | uint32_t(c.a) << 24;
+}
+
+// rgba8 channel to linear, the inverse of to_rgba8's gamma 2
+struct texel_decoder {
+    float linear[256];
+    texel_decoder() {
+        for (int i = 0; i < 256; i++) linear[i] = (i / 255.0f) * (i / 255.0f);
+    }
+    vec3 operator()(uint32_t t) const { return vec3(linear[t & 0xff], linear[(t >> 8) & 0xff], linear[(t >> 16) & 0xff]); }
+};
+const texel_decoder decode_texel;
+
+// Builds the tiled pyramid of the image at source and writes it to
+// tiled_path (through a temporary file, so readers never see half of one).
+bool write_tiled_texture(const std::string &source, const std::string &tiled_path) {
+    std::vector<vec3> pixels;
+    int width, height;
+    if (!read_image(source, pixels, width, height)) return false;
+
+    tiled_texture_header h = {};
+    memcpy(h.magic, tiled_texture_magic, sizeof(h.magic));
+    h.version = tiled_texture_version;
+    h.tile_size = texture_tile_size;
+    std::string stamp = file_stamp(source);
+    if (stamp.size() >= sizeof(h.source)) {
+        fprintf(stderr, "%s: path too long for a texture cache\n", source.c_str());
+        return false;
+    }
+    memcpy(h.source, stamp.data(), stamp.size());
+
+    std::vector<std::vector<vec3>> levels = {std::move(pixels)};
+    int w = width, ht = height;
+    for (;;) {
+        tiled_level &l = h.level[h.levels++];
+        l.width = w;
+        l.height = ht;
+        l.tiles_x = (w + texture_tile_size - 1) / texture_tile_size;
+        l.tiles_y = (ht + texture_tile_size - 1) / texture_tile_size;
+        l.first_tile = h.tile_count;
+        h.tile_count += uint64_t(l.tiles_x) * l.tiles_y;
+        if ((w == 1 && ht == 1) || h.levels == texture_max_levels) break;
+        // 2x2 box filter; an odd last row or column is averaged over what there is
+        int next_w = std::max(1, (w + 1) / 2), next_h = std::max(1, (ht + 1) / 2);
+        const std::vector<vec3> &fine = levels.back();
+        std::vector<vec3> coarse(size_t(next_w) * next_h);
+        for (int y = 0; y < next_h; y++) {
+            for (int x = 0; x < next_w; x++) {
+                vec3 sum(0, 0, 0);
+                int n = 0;
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        int fx = 2 * x + dx, fy = 2 * y + dy;
+                        if (fx >= w || fy >= ht) continue;
+                        sum += fine[size_t(fy) * w + fx];
+                        n++;
+                    }
+                }
+                coarse[size_t(y) * next_w + x] = sum / float(n);
+            }
+        }
+        levels.push_back(std::move(coarse));
+        w = next_w;
+        ht = next_h;
+    }
+
+    std::string temp_path = tiled_path + ".tmp";
+    FILE *f = fopen(temp_path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", temp_path.c_str());
+        return false;
+    }
+    std::vector<unsigned char> first(texture_tile_bytes, 0);
+    memcpy(first.data(), &h, sizeof(h));
+    bool ok = fwrite(first.data(), 1, first.size(), f) == first.size();
+    std::vector<uint32_t> tile(texture_tile_texels);
+    for (uint32_t k = 0; ok && k < h.levels; k++) {
+        const tiled_level &l = h.level[k];
+        const std::vector<vec3> &texels = levels[k];
+        for (uint32_t ty = 0; ok && ty < l.tiles_y; ty++) {
+            for (uint32_t tx = 0; tx < l.tiles_x; tx++) {
+                for (int y = 0; y < texture_tile_size; y++) {
+                    for (int x = 0; x < texture_tile_size; x++) {
+                        // past the edge repeats the edge, so partial tiles hold no garbage
+                        uint32_t px = std::min(tx * texture_tile_size + x, l.width - 1);
+                        uint32_t py = std::min(ty * texture_tile_size + y, l.height - 1);
+                        tile[morton2(x, y)] = pack_texel(texels[size_t(py) * l.width + px]);
+                    }
+                }
+                ok = ok && fwrite(tile.data(), 1, texture_tile_bytes, f) == size_t(texture_tile_bytes);
+            }
+        }
+    }
+    ok = fclose(f) == 0 && ok;
+    if (ok) ok = std::rename(temp_path.c_str(), tiled_path.c_str()) == 0;
+    if (!ok) {
+        std::remove(temp_path.c_str());
+        fprintf(stderr, "cannot write %s\n", tiled_path.c_str());
+    }
+    return ok;
+}
+
+// An open .tiles file and which cache slot holds each of its tiles.
+class tiled_image {
+public:
+    tiled_texture_header header;
+    uint32_t id;                                    // the high half of the cache keys of its tiles
+    std::unique_ptr<std::atomic<int32_t>[]> slot;   // by tile, -1 = never loaded; may be stale
+
+    tiled_image(const tiled_image &) = delete;
+    tiled_image &operator=(const tiled_image &) = delete;
+    ~tiled_image() {
+#ifndef _WIN32
+        if (fd >= 0) ::close(fd);
+#else
+        if (file) fclose(file);
+#endif
+    }
+
+    // The tiled version of the image at source: FILE.tiles if it was made
+    // from this version of it (or the image is gone), otherwise built now.
+    static std::unique_ptr<tiled_image> open(const std::string &source) {
+        std::string tiled_path = source + ".tiles";
+        std::unique_ptr<tiled_image> image(new tiled_image());
+        if (image->open_tiles(tiled_path, source)) return image;
+        if (!write_tiled_texture(source, tiled_path)) return nullptr;
+        image.reset(new tiled_image());
+        if (image->open_tiles(tiled_path, source)) return image;
+        fprintf(stderr, "cannot open %s\n", tiled_path.c_str());
+        return nullptr;
+    }
+
+    uint64_t key(uint64_t tile) const { return uint64_t(id) << 32 | tile; }
+
+    // false if the read failed
+    bool read_tile(uint64_t tile, void *out) {
+        uint64_t offset = (tile + 1) * texture_tile_bytes;
+#ifndef _WIN32
+        return pread(fd, out, texture_tile_bytes, off_t(offset)) == texture_tile_bytes;
+#else
+        std::lock_guard<std::mutex> lock(file_mutex);
+        return _fseeki64(file, offset, SEEK_SET) == 0 && fread(out, 1, texture_tile_bytes, file) == texture_tile_bytes;
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    int fd = -1;
+#else
+    FILE *file = nullptr;
+    std::mutex file_mutex;
+#endif
+
+    tiled_image() {
+        static std::atomic<uint32_t> next_id{1};
+        id = next_id++;
+    }
+
+    bool open_tiles(const std::string &tiled_path, const std::string &source) {
+#ifndef _WIN32
+        fd = ::open(tiled_path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        bool read = pread(fd, &header, sizeof(header), 0) == sizeof(header);
+#else
+        file = fopen(tiled_path.c_str(), "rb");
+        if (!file) return false;
+        bool read = fread(&header, sizeof(header), 1, file) == 1;
+#endif
+        std::string stamp = file_stamp(source);
+        bool valid = read && !memcmp(header.magic, tiled_texture_magic, sizeof(header.magic)) &&
+                     header.version == tiled_texture_version && header.tile_size == uint32_t(texture_tile_size) &&
+                     header.levels >= 1 && header.levels <= uint32_t(texture_max_levels) &&
+                     header.source[sizeof(header.source) - 1] == 0 && (stamp.empty() || stamp == header.source);
+        if (valid) {
+            // every tile must be in the file
+            std::error_code ec;
+            auto size = std::filesystem::file_size(tiled_path, ec);
+            valid = !ec && size >= (header.tile_count + 1) * texture_tile_bytes;
+        }
+        if (!valid) return false;
+        slot.reset(new std::atomic<int32_t>[header.tile_count]);
+        for (uint64_t k = 0; k < header.tile_count; k++) slot[k].store(-1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+struct texture_cache_stats {
+    std::atomic<uint64_t> loads{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> read_errors{0};
+
+    void print(size_t capacity_bytes) const {
+        fprintf(stderr, "textures: %llu tiles read (%.1f MB), %llu evicted, %.0f MB cache\n",
+                (unsigned long long)loads.load(), loads.load() * double(texture_tile_bytes) / (1 << 20),
+                (unsigned long long)evictions.load(), capacity_bytes / double(1 << 20));
+    }
+};
+
+class texture_cache {
+public:
+    texture_cache_stats stats;
+
+    explicit texture_cache(size_t capacity_bytes) { set_capacity(capacity_bytes); }
+
+    // Drops every cached tile; only while nothing is rendering.
+    void set_capacity(size_t capacity_bytes) {
+        slot_count = std::max<size_t>(min_slots, capacity_bytes / texture_tile_bytes);
+        slots.reset(new slot_state[slot_count]);
+        texels.reset(new uint32_t[slot_count * texture_tile_texels]);
+        hand = 0;
+    }
+    size_t capacity_bytes() const { return slot_count * texture_tile_bytes; }
+
+    // The texels (x0, y0), (x1, y0), (x0, y1), (x1, y1) of a level, all
+    // inside it, in that order. One slot check per tile they fall in.
+    void texel_quad(tiled_image &image, int level, int x0, int y0, int x1, int y1, uint32_t out[4]) {
+        const int t = texture_tile_size;
+        bool same_x = x0 / t == x1 / t, same_y = y0 / t == y1 / t;
+        uint32_t offsets[4] = {morton2(x0 % t, y0 % t), morton2(x1 % t, y0 % t), morton2(x0 % t, y1 % t),
+                               morton2(x1 % t, y1 % t)};
+        if (same_x && same_y) {
+            read(image, tile_of(image, level, x0, y0), offsets, 4, out);
+        } else if (same_x) {
+            // a row in each tile
+            read(image, tile_of(image, level, x0, y0), offsets, 2, out);
+            read(image, tile_of(image, level, x0, y1), offsets + 2, 2, out + 2);
+        } else {
+            int xs[4] = {x0, x1, x0, x1}, ys[4] = {y0, y0, y1, y1};
+            for (int k = 0; k < 4; k++) read(image, tile_of(image, level, xs[k], ys[k]), &offsets[k], 1, &out[k]);
+        }
+    }
+
+private:
+    static const size_t min_slots = 256;    // 1 MB, enough for every thread's working set
+
+    struct alignas(64) slot_state {
+        std::atomic<uint32_t> generation{0};    // odd while the slot is refilled
+        std::atomic<uint64_t> owner{~0ull};     // tiled_image::key of the tile in it
+        std::atomic<uint8_t> referenced{0};     // for the clock
+    };
+
+    std::unique_ptr<slot_state[]> slots;
+    std::unique_ptr<uint32_t[]> texels;         // slot_count tiles, only accessed through atomic_ref
+    size_t slot_count = 0;
+    size_t hand = 0;                            // the clock's, guarded by mutex
+    std::mutex mutex;
+
+    static uint64_t tile_of(const tiled_image &image, int level, int x, int y) {
+        const tiled_level &l = image.header.level[level];
+        return l.first_tile + uint64_t(y / texture_tile_size) * l.tiles_x + x / texture_tile_size;
+    }
+
+    void read(tiled_image &image, uint64_t tile, const uint32_t *offsets, int n, uint32_t *out) {
+        uint64_t key = image.key(tile);
+        for (;;) {
+            int32_t s = image.slot[tile].load(std::memory_order_acquire);
+            if (s >= 0) {
+                slot_state &st = slots[s];
+                uint32_t g = st.generation.load(std::memory_order_acquire);
+                if (st.owner.load(std::memory_order_relaxed) == key) {
+                    if (g & 1) {
+                        std::this_thread::yield();    // another thread is reading it in
+                        continue;
+                    }
+                    uint32_t *tile_texels = &texels[size_t(s) * texture_tile_texels];
+                    for (int k = 0; k < n; k++) {
+                        out[k] = std::atomic_ref<uint32_t>(tile_texels[offsets[k]]).load(std::memory_order_relaxed);
+                    }
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (st.generation.load(std::memory_order_relaxed) == g) {
+                        if (!st.referenced.load(std::memory_order_relaxed)) {
+                            st.referenced.store(1, std::memory_order_relaxed);
+                        }
+                        return;
+                    }
+                    continue;
+                }
+            }
+            load(image, tile);
+        }
+    }
+
+    // brings tile into a slot, unless another thread already has (or is)
+    void load(tiled_image &image, uint64_t tile) {
+        uint64_t key = image.key(tile);
+        slot_state *st;
+        uint32_t g;
+        size_t s;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            int32_t current = image.slot[tile].load(std::memory_order_relaxed);
+            if (current >= 0 && slots[current].owner.load(std::memory_order_relaxed) == key) return;
+            // clock: skip recently used slots and slots being filled
+            for (;;) {
+                s = hand;
+                hand = (hand + 1) % slot_count;
+                slot_state &candidate = slots[s];
+                if (candidate.generation.load(std::memory_order_relaxed) & 1) continue;
+                if (candidate.referenced.load(std::memory_order_relaxed)) {
+                    candidate.referenced.store(0, std::memory_order_relaxed);
+                    continue;
+                }
+                break;
+            }
+            st = &slots[s];
+            if (st->owner.load(std::memory_order_relaxed) != ~0ull) stats.evictions++;
+            g = st->generation.load(std::memory_order_relaxed);
+            st->generation.store(g + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            st->owner.store(key, std::memory_order_relaxed);
+            st->referenced.store(1, std::memory_order_relaxed);
+            image.slot[tile].store(int32_t(s), std::memory_order_release);
+        }
+
+        static thread_local std::vector<uint32_t> buffer(texture_tile_texels);
+        if (!image.read_tile(tile, buffer.data())) {
+            // shows up as black rather than stopping the render
+            if (stats.read_errors++ == 0) fprintf(stderr, "cannot read a texture tile\n");
+            std::fill(buffer.begin(), buffer.end(), 0u);
+        }
+        uint32_t *tile_texels = &texels[s * texture_tile_texels];
+        for (int k = 0; k < texture_tile_texels; k++) {
+            std::atomic_ref<uint32_t>(tile_texels[k]).store(buffer[k], std::memory_order_relaxed);
+        }
+        st->generation.store(g + 2, std::memory_order_release);
+        stats.loads++;
+    }
+};
+
+// the cache every image texture reads through (see --texture-cache)
+texture_cache &texture_tiles() {
+    static texture_cache cache(size_t(256) << 20);
+    return cache;
+}
+
+// An image as a texture: (u, v) from the surface (repeated scale times) or,
+// with planar mapping, from the hit point's x and z (scale repeats per unit),
+// which suits ground planes and anything without coordinates of its own.
+// Wraps around at the edges. The mip level comes from the ray cone's width
+// at the hit (rec.footprint) over the world size of a texel; between two
+// levels the lookup blends them (trilinear).
+class image_texture : public texture {
+public:
+    enum mapping { map_uv, map_planar };
+
+    image_texture(std::unique_ptr<tiled_image> image, mapping kind = map_uv, float scale = 1)
+        : image(std::move(image)), kind(kind), scale(scale) {
+        const tiled_level &top = this->image->header.level[0];
+        size = float(std::max(top.width, top.height));
+    }
+
+    virtual vec3 value(const hit_record &rec) const {
+        float u, v, uv_length;
+        if (kind == map_planar) {
+            u = rec.p.x() * scale;
+            v = rec.p.z() * scale;
+            uv_length = 1 / scale;
+        } else {
+            surface_uv(rec, u, v);
+            u *= scale;
+            v *= scale;
+            uv_length = rec.uv_length / scale;
+        }
+        int levels = int(image->header.levels);
+        float lod = 0;
+        if (rec.footprint > 0 && uv_length > 0) {
+            lod = std::clamp(std::log2(rec.footprint * size / uv_length), 0.0f, float(levels - 1));
+        }
+        int level = int(lod);
+        float blend = lod - level;
+        vec3 c = bilinear(level, u, v);
+        if (blend > 0 && level + 1 < levels) c = c * (1 - blend) + bilinear(level + 1, u, v) * blend;
+        return c;
+    }
+
+private:
+    std::unique_ptr<tiled_image> image;
+    mapping kind;
+    float scale;
+    float size;     // of level 0, in texels
+
+    vec3 bilinear(int level, float u, float v) const {
+        const tiled_level &l = image->header.level[level];
+        int w = int(l.width), h = int(l.height);
+        // rows go down the image, v up; noise_floor as std::floor is a libm call here
+        float x = (u - float(noise_floor(u))) * w - 0.5f;
+        float y = (1 - (v - float(noise_floor(v)))) * h - 0.5f;
+        int x0 = noise_floor(x), y0 = noise_floor(y);    // -1 to size - 1
+        float tx = x - float(x0), ty = y - float(y0);
+        // wrapped around
+        int x1 = x0 + 1 == w ? 0 : x0 + 1, y1 = y0 + 1 == h ? 0 : y0 + 1;
+        x0 = x0 < 0 ? w - 1 : std::min(x0, w - 1);
+        y0 = y0 < 0 ? h - 1 : std::min(y0, h - 1);
+        x1 = std::min(x1, w - 1);
+        y1 = std::min(y1, h - 1);
+        uint32_t t[4];
+        texture_tiles().texel_quad(*image, level, x0, y0, x1, y1, t);
+        vec3 top = decode_texel(t[0]) * (1 - tx) + decode_texel(t[1]) * tx;
+        vec3 bottom = decode_texel(t[2]) * (1 - tx) + decode_texel(t[3]) * tx;
+        return top * (1 - ty) + bottom * ty;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_IMAGE_TEXTURE_H
@@ -0,0 +1,117 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_INSTANCE_H
+#define CPU_CPP_RAYTRACING_INSTANCE_H
+#include <cmath>
+#include <cstdint>
+#include "aabb.h"
+#include "ray.h"
+#include "vec3.h"
+
+// Affine transform: a 3x3 linear part and a translation in the last column,
+// row major.
+struct affine {
+    float m[3][4];
+
+    static affine identity() { return scale(vec3(1, 1, 1)); }
+
+    static affine translate(const vec3 &t) {
+        affine a = identity();
+        for (int r = 0; r < 3; r++) a.m[r][3] = t[r];
+        return a;
+    }
+
+    static affine scale(const vec3 &s) {
+        affine a = {};
+        for (int r = 0; r < 3; r++) a.m[r][r] = s[r];
+        return a;
+    }
+
+    // counterclockwise about axis, looking down it
+    static affine rotate(const vec3 &axis, float degrees) {
+        vec3 n = unit_vector(axis);
+        float rad = degrees * float(M_PI) / 180;
+        float c = std::cos(rad), s = std::sin(rad), t = 1 - c;
+        float x = n.x(), y = n.y(), z = n.z();
+        affine a = {};
+        a.m[0][0] = t * x * x + c;     a.m[0][1] = t * x * y - s * z; a.m[0][2] = t * x * z + s * y;
+        a.m[1][0] = t * x * y + s * z; a.m[1][1] = t * y * y + c;     a.m[1][2] = t * y * z - s * x;
+        a.m[2][0] = t * x * z - s * y; a.m[2][1] = t * y * z + s * x; a.m[2][2] = t * z * z + c;
+        return a;
+    }
+
+    // b first, then this
+    affine operator*(const affine &b) const {
+        affine a = {};
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 4; c++) {
+                float sum = c == 3 ? m[r][3] : 0;
+                for (int k = 0; k < 3; k++) sum += m[r][k] * b.m[k][c];
+                a.m[r][c] = sum;
+            }
+        }
+        return a;
+    }
+
+    vec3 point(const vec3 &p) const {
+        return vec3(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+                    m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+                    m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]);
+    }
+
+    vec3 vector(const vec3 &v) const {
+        return vec3(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+                    m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+                    m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+    }
+
+    // false (leaving out alone) for a singular transform
+    bool inverse(affine &out) const {
+        float a = m[0][0], b = m[0][1], c = m[0][2];
+        float d = m[1][0], e = m[1][1], f = m[1][2];
+        float g = m[2][0], h = m[2][1], i = m[2][2];
+        float det = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+        if (!(std::fabs(det) > 1e-20f)) return false;
+        float inv = 1 / det;
+        affine r = {};
+        r.m[0][0] = (e * i - f * h) * inv; r.m[0][1] = (c * h - b * i) * inv; r.m[0][2] = (b * f - c * e) * inv;
+        r.m[1][0] = (f * g - d * i) * inv; r.m[1][1] = (a * i - c * g) * inv; r.m[1][2] = (c * d - a * f) * inv;
+        r.m[2][0] = (d * h - e * g) * inv; r.m[2][1] = (b * g - a * h) * inv; r.m[2][2] = (a * e - b * d) * inv;
+        vec3 t = r.vector(vec3(m[0][3], m[1][3], m[2][3]));
+        for (int k = 0; k < 3; k++) r.m[k][3] = -t[k];
+        out = r;
+        return true;
+    }
+
+    // the box around the transformed corners of box
+    aabb bounds(const aabb &box) const {
+        aabb out;
+        for (int k = 0; k < 8; k++) {
+            out.expand(point(vec3(k & 1 ? box.pmax[0] : box.pmin[0], k & 2 ? box.pmax[1] : box.pmin[1],
+                                  k & 4 ? box.pmax[2] : box.pmin[2])));
+        }
+        return out;
+    }
+};
+
+// One placement of a shared mesh (see scene::add_instance). Plain data, so a
+// compiled scene file can hold them as they are. Only the world to mesh
+// transform is kept, which is what traversal uses; the way back is only
+// needed at the closest hit and inverted there.
+struct mesh_instance {
+    affine to_object;
+    uint32_t mesh;
+    uint32_t material;
+
+    // the ray in mesh space, with the same t along it (so not normalized)
+    ray object_ray(const ray &r) const {
+        ray local;
+        local.a = to_object.point(r.a);
+        local.b = to_object.vector(r.b);
+        return local;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_INSTANCE_H
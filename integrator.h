@@ -0,0 +1,175 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_INTEGRATOR_H
+#define CPU_CPP_RAYTRACING_INTEGRATOR_H
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "hitable.h"
+#include "light.h"
+#include "material.h"
+#include "ray.h"
+#include "render_stats.h"
+#include "sampler.h"
+
+// When paths stop, looked up by the material class of the surface that was
+// hit. depth counts the scattering events before the hit (0 for camera rays).
+struct bounce_policy {
+    int max_depth[material_type_count];     // no scattering at depth >= max_depth
+    int min_depth[material_type_count];     // russian roulette from this depth on
+    bool russian_roulette = true;
+    float rr_threshold = 0.25f;             // only paths darker than this play
+
+    bounce_policy() {
+        std::fill(max_depth, max_depth + material_type_count, 50);
+        std::fill(min_depth, min_depth + material_type_count, 3);
+    }
+
+    // Unbiased russian roulette after a scatter: a path whose throughput fell
+    // below rr_threshold goes on with probability p = max(throughput) /
+    // rr_threshold and the survivors are weighted by 1/p, so near-black paths
+    // stop early while bright ones (glass keeps its throughput) are never cut.
+    // Returns false when the path is terminated.
+    bool survive(int type, int depth, vec3 &throughput, sampler &s) const {
+        if (!russian_roulette || depth < min_depth[type]) return true;
+        float p = std::max(throughput[0], std::max(throughput[1], throughput[2])) / rr_threshold;
+        if (p >= 1) return true;
+        if (s.next_1d() >= p) return false;
+        throughput /= p;
+        return true;
+    }
+};
+
+enum integrator_type {
+    integrator_path,        // one path at a time
+    integrator_wavefront,   // all paths of a tile one bounce at a time
+};
+
+struct render_settings {
+    uint64_t seed = 0;
+    integrator_type integrator = integrator_path;
+    bounce_policy bounces;
+    float noise_threshold = 0;  // adaptive sampling: stop pixels below this error (display units), 0 = off
+    int min_samples = 16;       // before a pixel may stop
+    int samples_per_pass = 1;   // per pixel, taken tile by tile; more amortizes the per-pass sync
+    sampler_type sampling = sampler_sobol;
+    int sample_count = 64;      // per pixel, what the stratified sampler lays its strata out for
+};
+
+// sky gradient seen by rays that leave the scene
+inline vec3 background(const vec3 &direction) {
+    vec3 unit_direction = unit_vector(direction);
+    double t = 0.5 * (unit_direction.y() + 1.0);
+    return (1.0 - t) * vec3(1.0, 1.0, 1.0) + t * vec3(0.5, 0.7, 1.0);
+}
+
+// Ray cones (Akenine-Moller et al., "Texture Level of Detail Strategies for
+// Real-Time Ray Tracing"): a path carries the width of its cone and how
+// fast it grows. Camera rays start at width 0 with the angle of one pixel;
+// every scatter adds the material's spread. Textures pick their mip level
+// from the width at the hit, so rays after a diffuse bounce read coarse,
+// cache friendly levels. Curvature is ignored.
+struct ray_cone {
+    float width = 0;
+    float spread = 0;
+
+    // width at the hit, handed to the material through rec.footprint
+    void reach(hit_record &rec) {
+        width += spread * rec.t;    // ray directions are unit length
+        rec.footprint = width;
+    }
+    void scatter(const material &m) { spread += m.scatter_spread(); }
+};
+
+// Next-event estimation at a hit on a material that samples_lights(): one
+// point on a light, its radiance if a shadow ray reaches it, weighted
+// against finding the same point by scattering (multiple importance
+// sampling). The caller multiplies by the throughput. Always draws the
+// light sample's dimensions, so an occluded light leaves the path's later
+// dimensions where they were.
+inline vec3 sample_direct(const ray &r, const hit_record &rec, hitable *world, const light_list &lights, sampler &s) {
+    light_sample light = lights.sample(s);
+    vec3 to_light = light.p - rec.p;
+    float dist2 = to_light.squared_length();
+    float dist = std::sqrt(dist2);
+    vec3 wi = to_light / dist;
+    float cos_light = -dot(wi, light.normal);
+    if (!(cos_light > 0)) return vec3(0, 0, 0);     // its back, or the light itself
+    const material &m = *rec.mat_ptr;
+    vec3 f = m.eval(r, rec, wi);
+    if (f[0] <= 0 && f[1] <= 0 && f[2] <= 0) return vec3(0, 0, 0);
+
+    RT_STAT(render_stats::local().rays++);
+    RT_STAT(render_stats::local().shadow_rays++);
+    ray shadow;
+    shadow.a = rec.p;
+    shadow.b = wi;
+    hit_record blocker;
+    if (world->hit(shadow, 0.001, dist * (1 - 1e-3f), blocker)) return vec3(0, 0, 0);
+    float light_pdf = light.pdf_area * dist2 / cos_light;      // per solid angle
+    return f * light.emit * (power_heuristic(light_pdf, m.pdf(r, rec, wi)) / light_pdf);
+}
+
+// The share of the emission a path finds by scattering into a light, the
+// other half of sample_direct's weighting. bsdf_pdf is the density of the
+// scatter that led here, 0 for camera rays and after a material that does
+// not sample lights: those paths are the only way to see the light and
+// keep all of it. So are emitters that are not in the light list. r has a
+// unit direction, so rec.t is the distance.
+inline float emission_weight(const ray &r, const hit_record &rec, const light_list *lights, float bsdf_pdf,
+                             const vec3 &emit) {
+    if (!lights || bsdf_pdf <= 0 || !rec.listed_light) return 1;
+    float cos_light = -dot(r.direction(), rec.normal);
+    return power_heuristic(bsdf_pdf, lights->pdf_area(emit) * rec.t * rec.t / cos_light);
+}
+
+// One path at a time, iteratively: the throughput is carried along instead
+// of multiplying attenuations back up a recursion. Light arrives from the
+// sky when the path leaves the scene, from emissive surfaces it hits, and,
+// when the world has a light list, from a light sampled at every surface
+// that allows it.
+vec3 color(ray r, hitable *world, const bounce_policy &bounces, sampler &s, ray_cone cone = {}) {
+    const light_list *lights = world->lights();
+    vec3 throughput(1, 1, 1);
+    vec3 result(0, 0, 0);
+    float bsdf_pdf = 0;     // of the last scatter, see emission_weight
+    int depth = 0;
+    for (;; depth++) {
+        RT_STAT(render_stats::local().rays++);
+        hit_record rec;
+        if (!world->hit(r, 0.001, INFINITY, rec)) {
+            result += throughput * background(r.direction());
+            break;
+        }
+
+        cone.reach(rec);
+        const material &m = *rec.mat_ptr;
+        int type = m.type;
+        if (type == material_light) {
+            if (dot(r.direction(), rec.normal) < 0) {
+                vec3 emit = m.emitted(rec);
+                result += throughput * emit * emission_weight(r, rec, lights, bsdf_pdf, emit);
+            }
+            break;
+        }
+        if (depth >= bounces.max_depth[type]) break;
+        bool direct = lights && m.samples_lights();
+        if (direct) result += throughput * sample_direct(r, rec, world, *lights, s);
+        RT_STAT(render_stats::local().scatter_calls[type]++);
+        ray scattered;
+        vec3 attenuation;
+        if (!m.scatter(r, rec, attenuation, scattered, s)) break;
+        bsdf_pdf = direct ? m.pdf(r, rec, scattered.direction()) : 0;
+        throughput *= attenuation;
+        if (!bounces.survive(type, depth, throughput, s)) break;
+        cone.scatter(m);
+        r = scattered;
+    }
+    RT_STAT(render_stats::local().add_path(depth + 1));
+    return result;
+}
+
+#endif //CPU_CPP_RAYTRACING_INTEGRATOR_H
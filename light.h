@@ -0,0 +1,138 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_LIGHT_H
+#define CPU_CPP_RAYTRACING_LIGHT_H
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "common.h"
+#include "hitable.h"
+#include "material.h"
+#include "sampler.h"
+#include "vec3.h"
+
+// Emissive surface: radiance emit leaves the front (the side the normal
+// points to), nothing is scattered. Spheres and triangles with it, including
+// the triangles of instanced meshes, become area lights (see light_list).
+class diffuse_light : public material {
+public:
+    vec3 emit;
+    explicit diffuse_light(const vec3 &emit) : material(material_light), emit(emit) {}
+    virtual bool scatter(const ray &, const hit_record &, vec3 &, ray &, sampler &) const { return false; }
+    virtual vec3 emitted(const hit_record &) const { return emit; }
+};
+
+// how bright a light is for picking it, the mean of its channels
+inline float light_power(const vec3 &emit) {
+    return (emit[0] + emit[1] + emit[2]) / 3;
+}
+
+// Power heuristic (beta = 2) weight of a strategy with density a against one
+// with density b (Veach 1997).
+inline float power_heuristic(float a, float b) {
+    a *= a;
+    b *= b;
+    return a / (a + b);
+}
+
+// a point on a light, and the area density with which it was picked
+struct light_sample {
+    vec3 p;
+    vec3 normal;        // unit length, pointing to the emitting side
+    vec3 emit;
+    float pdf_area;
+};
+
+// The emissive primitives of a scene, for next-event estimation. A light is
+// picked with probability proportional to its power (light_power() times
+// area) and a point uniformly on its surface, so the area density of any
+// point on any light is light_power(emit) / total_power, whatever light it
+// lies on. That is what lets a path that hits a light by scattering weigh
+// itself against light sampling (pdf_area()) without knowing which light it
+// hit. Spheres are sampled over their whole surface.
+//
+// Only the packet primitives of a scene are listed: an emissive hitable
+// object is still seen by scattering into it, but not sampled, so those
+// hits keep all their emission (see hit_record::listed_light).
+class light_list {
+public:
+    void clear() {
+        lights.clear();
+        cdf.clear();
+        total_power = 0;
+    }
+
+    // the normal follows the winding, like the triangle's hits
+    void add_triangle(const vec3 &v0, const vec3 &e1, const vec3 &e2, const vec3 &emit) {
+        vec3 n = cross(e1, e2);
+        float area = 0.5f * n.length();
+        if (!(area > 0) || !(light_power(emit) > 0)) return;
+        lights.push_back({v0, e1, e2, n / (2 * area), emit, area, false});
+    }
+
+    // a negative radius turns the normal, and with it the emitting side, inwards
+    void add_sphere(const vec3 &center, float radius, const vec3 &emit) {
+        float area = 4 * float(M_PI) * radius * radius;
+        if (!(area > 0) || !(light_power(emit) > 0)) return;
+        lights.push_back({center, vec3(radius, 0, 0), vec3(0, 0, 0), vec3(0, 0, 0), emit, area, true});
+    }
+
+    // after the last add_*()
+    void build() {
+        cdf.resize(lights.size());
+        double sum = 0;
+        for (size_t i = 0; i < lights.size(); i++) {
+            sum += double(light_power(lights[i].emit)) * lights[i].area;
+            cdf[i] = float(sum);
+        }
+        total_power = float(sum);
+        for (float &c : cdf) c /= total_power;
+    }
+
+    bool empty() const { return lights.empty(); }
+    size_t size() const { return lights.size(); }
+
+    // area density of a point on a light emitting emit
+    float pdf_area(const vec3 &emit) const { return light_power(emit) / total_power; }
+
+    // always draws one 1D and one 2D sample from s, so paths stay in step whatever they hit
+    light_sample sample(sampler &s) const {
+        float pick = s.next_1d();
+        point2 u = s.next_2d();
+        size_t i = std::upper_bound(cdf.begin(), cdf.end(), pick) - cdf.begin();
+        const area_light &l = lights[std::min(i, lights.size() - 1)];
+        light_sample out;
+        out.emit = l.emit;
+        out.pdf_area = pdf_area(l.emit);
+        if (l.sphere) {
+            vec3 n = sample_unit_sphere(u);
+            float radius = l.e1[0];
+            out.p = l.v0 + radius * n;
+            out.normal = radius > 0 ? n : -n;
+        } else {
+            // uniform on the triangle through the square root warp
+            float su = std::sqrt(u.x);
+            out.p = l.v0 + (su * (1 - u.y)) * l.e1 + (su * u.y) * l.e2;
+            out.normal = l.normal;
+        }
+        return out;
+    }
+
+private:
+    // a triangle (v0, e1, e2), or a sphere with its center in v0 and radius in e1
+    struct area_light {
+        vec3 v0, e1, e2;
+        vec3 normal;
+        vec3 emit;
+        float area;
+        bool sphere;
+    };
+    std::vector<area_light> lights;
+    std::vector<float> cdf;         // running power over the lights, the last one 1
+    float total_power = 0;
+};
+
+#endif //CPU_CPP_RAYTRACING_LIGHT_H
@@ -1,141 +1,472 @@
-#include <thread>
-#include <mutex>
-#include <atomic>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
-#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
 #include <vector>
-#include <deque>
 
 #include "camera.h"
-#include "cube.h"
+#include "checkpoint.h"
+#include "denoise.h"
+#include "distributed.h"
+#include "film.h"
 #include "hitable.h"
-#include "hitable_list.h"
-#include "materials.h"
+#include "image_io.h"
+#include "options.h"
+#include "progressive.h"
 #include "ray.h"
+#include "renderer.h"
+#include "resolve.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scenes.h"
+#include "simd.h"
+#include "thread_pool.h"
+#ifdef RT_WITH_RAYLIB
 #include "raylib.h"
-#include "sphere.h"
+#endif
 
-std::mutex pixel_mutex;
-std::atomic<int> lines_done(0);
-std::atomic<bool> rendering_done(false);
+// one primary ray through every pixel center, counting BVH work
+void print_traversal_stats(const scene &world, camera &cam, int nx, int ny) {
+    bvh_traversal_stats traversal;
+    auto start = std::chrono::steady_clock::now();
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            hit_record rec;
+            world.hit_counted(cam.get_ray((i + 0.5f) / nx, (j + 0.5f) / ny), 0.001, INFINITY, rec, traversal);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    traversal.print("primary rays");
+    fprintf(stderr, "primary rays: %.2f Mrays/s on one thread (counting enabled)\n", traversal.rays / seconds * 1e-6);
+}
 
-struct Task {
-    int start_y;
-    int end_y;
-};
+using clock_point = std::chrono::steady_clock::time_point;
 
-std::mutex task_mutex;
-std::condition_variable task_cv;
-std::deque<Task> tasks;
-bool all_done = false;
-
-vec3 color(const ray& r, hitable *world, int depth) {
-    hit_record rec;
-    if (world->hit(r, 0.001, INFINITY, rec)) {
-        ray scattered;
-        vec3 attenuation;
-        if (depth < 50 && rec.mat_ptr->scatter(r, rec, attenuation, scattered)) {
-            return attenuation * color(scattered, world, depth + 1);
+double ms_since(clock_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// the output image (denoised if given), and the heatmap if asked for
+bool write_outputs(const render_options &opt, const film &image, tile_scheduler &pool,
+                   const film *denoised = nullptr) {
+    const film &shown = denoised ? *denoised : image;
+    // only the representation the format stores
+    std::vector<vec3> linear;
+    std::vector<rgba8> display;
+    if (is_hdr_format(opt.output)) {
+        linear = resolve_linear(shown, opt.display);
+    } else {
+        display.resize(shown.sum.size());
+        resolve(pool, shown, display.data(), opt.display);
+    }
+    if (!write_image(opt.output, linear, display, image.nx, image.ny)) {
+        fprintf(stderr, "failed to write %s\n", opt.output.c_str());
+        return false;
+    }
+    fprintf(stderr, "wrote %s\n", opt.output.c_str());
+    if (!opt.heatmap.empty()) {
+        if (!write_image(opt.heatmap, image.heatmap(), image.nx, image.ny)) {
+            fprintf(stderr, "failed to write %s\n", opt.heatmap.c_str());
+            return false;
         }
-        return vec3(0, 0, 0);
+        fprintf(stderr, "wrote %s\n", opt.heatmap.c_str());
     }
-    vec3 unit_direction = unit_vector(r.direction());
-    double t = 0.5 * (unit_direction.y() + 1.0);
-    return (1.0 - t) * vec3(1.0, 1.0, 1.0) + t * vec3(0.5, 0.7, 1.0);
+    return true;
 }
 
-void render_scanlines(Color* pixels, std::vector<vec3>& accum, int nx, int ny, hitable* world, camera& cam, int current_sample, int start_y, int end_y) {
-    for (int j = start_y; j < end_y; j++) {
-        for (int i = 0; i < nx; i++) {
-            float u = float(i + dist(gen)) / float(nx);
-            float v = float(j + dist(gen)) / float(ny);
-            ray r = cam.get_ray(u, v);
-            vec3 c = color(r, world, 0);
-
-            int idx = (ny - 1 - j) * nx + i;
-            accum[idx] += c;  // accumulate sample
-
-            vec3 avg = accum[idx] / float(current_sample);
-            avg = vec3(sqrt(avg[0]), sqrt(avg[1]), sqrt(avg[2])) * 255.99f;
-
-            pixels[idx] = {
-                (unsigned char)std::clamp(avg[0], 0.0f, 255.0f),
-                (unsigned char)std::clamp(avg[1], 0.0f, 255.0f),
-                (unsigned char)std::clamp(avg[2], 0.0f, 255.0f),
-                255
-            };
+// --aovs: the denoiser's guide buffers as PREFIX_albedo.pfm, PREFIX_normal.pfm and PREFIX_depth.pfm (sky = 0)
+bool write_aovs(const std::string &prefix, const feature_buffers &features) {
+    std::vector<vec3> depth(features.depth.size());
+    for (size_t i = 0; i < depth.size(); i++) {
+        float d = features.depth[i] >= feature_buffers::sky_depth ? 0.0f : features.depth[i];
+        depth[i] = vec3(d, d, d);
+    }
+    const std::vector<vec3> *buffers[3] = {&features.albedo, &features.normal, &depth};
+    const char *names[3] = {"_albedo.pfm", "_normal.pfm", "_depth.pfm"};
+    for (int k = 0; k < 3; k++) {
+        std::string path = prefix + names[k];
+        if (!write_image(path, *buffers[k], features.nx, features.ny)) {
+            fprintf(stderr, "failed to write %s\n", path.c_str());
+            return false;
         }
+        fprintf(stderr, "wrote %s\n", path.c_str());
     }
+    return true;
+}
+
+// write_outputs, after the feature pass and the denoiser when --denoise or --aovs ask for them
+bool finish_outputs(const render_options &opt, const film &image, hitable *world, camera &cam, tile_scheduler &pool) {
+    if (!opt.denoise && opt.aovs.empty()) return write_outputs(opt, image, pool);
+    feature_buffers features;
+    clock_point start = std::chrono::steady_clock::now();
+    render_features(pool, world, cam, image.nx, image.ny, features);
+    double features_ms = ms_since(start);
+    if (!opt.aovs.empty() && !write_aovs(opt.aovs, features)) return false;
+    if (!opt.denoise) return write_outputs(opt, image, pool);
+
+    film denoised(0, 0);
+    denoiser filter;
+    start = std::chrono::steady_clock::now();
+    filter.run(pool, image, features, denoised);
+    double ms = ms_since(start);
+    double megapixels = double(image.nx) * image.ny * 1e-6;
+    fprintf(stderr, "denoised in %.1f ms (%.1f ms per megapixel, %s kernel), feature pass %.1f ms\n", ms,
+            ms / megapixels, simd.name, features_ms);
+    return write_outputs(opt, image, pool, &denoised);
+}
+
+// What the scene is, for the checkpoint key: its name and size, the camera,
+// and the stamps of the files it was made from (a scene file, its meshes and
+// images, or the --obj mesh).
+std::string scene_identity(const render_options &opt, const scene_file &file) {
+    const scene_camera &c = file.camera;
+    char text[512];
+    snprintf(text, sizeof(text), "|%d|%g %g %g|%g %g %g|%g %g %g|%g|", opt.count, c.lookfrom[0], c.lookfrom[1],
+             c.lookfrom[2], c.lookat[0], c.lookat[1], c.lookat[2], c.vup[0], c.vup[1], c.vup[2], c.fov);
+    std::string id = opt.scene + text + opt.obj + "|";
+    if (!opt.obj.empty()) id += file_stamp(opt.obj);
+    return id + file.input_stamps();
 }
 
-void render_pass(Color* pixels, std::vector<vec3>& accum, int nx, int ny,
-                 hitable* world, camera& cam, int current_sample) {
-    int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 4;
+// the checkpoint for this render, or nullptr without --checkpoint (or when it cannot be opened)
+std::unique_ptr<checkpoint_file> open_checkpoint(const render_options &opt, const scene_file &file,
+                                                 const render_settings &settings) {
+    if (opt.checkpoint.empty()) return nullptr;
+    auto checkpoint = std::make_unique<checkpoint_file>();
+    checkpoint->interval_seconds = opt.checkpoint_interval;
+    uint64_t key = render_key(scene_identity(opt, file), settings);
+    if (!checkpoint->open(opt.checkpoint, opt.nx, opt.ny, key, opt.resume)) return nullptr;
+    return checkpoint;
+}
 
-    std::vector<std::thread> pool;
-    int rows_per_thread = ny / num_threads;
+int render_headless(const render_options &opt, const render_settings &settings, hitable *world, camera &cam,
+                    tile_scheduler &pool, clock_point launched, checkpoint_file *checkpoint) {
+    const int nx = opt.nx;
+    const int ny = opt.ny;
+    film image(nx, ny);
 
-    for (int t = 0; t < num_threads; t++) {
-        int start_y = t * rows_per_thread;
-        int end_y = (t == num_threads - 1) ? ny : start_y + rows_per_thread;
-        pool.emplace_back(render_scanlines, pixels, std::ref(accum), nx, ny,
-                          world, std::ref(cam), current_sample, start_y, end_y);
+    int first = 0;
+    double resumed_seconds = 0;
+    if (checkpoint && checkpoint->restore(image, first, resumed_seconds)) {
+        fprintf(stderr, "resumed from %s at %d samples, %.2fs rendered before\n", checkpoint->file_path().c_str(),
+                first, resumed_seconds);
     }
 
-    for (auto& th : pool) th.join();
+    RT_STAT(render_stats::reset());     // drop anything --stats counted
+    auto start = std::chrono::steady_clock::now();
+    auto seconds_since_start = [&] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    render_settings batch = settings;
+    int s = first;
+    for (; s < opt.spp; s += batch.samples_per_pass) {
+        batch.samples_per_pass = std::min(settings.samples_per_pass, opt.spp - s);
+        if (render_pass(pool, image, world, cam, batch) == 0) break;  // everything converged
+        if (s == first) fprintf(stderr, "startup: first pass done %.1f ms after launch\n", ms_since(launched));
+        fprintf(stderr, "\rsamples done: %d/%d", s + batch.samples_per_pass, opt.spp);
+        if (checkpoint && checkpoint->due()) {
+            checkpoint->save(image, s + batch.samples_per_pass, resumed_seconds + seconds_since_start());
+        }
+    }
+    double seconds = seconds_since_start();
+    if (checkpoint) checkpoint->save(image, std::min(s, opt.spp), resumed_seconds + seconds);
+    double samples = double(image.total_samples());
+    fprintf(stderr, "\nrendered %dx%d @ %.1f spp (max %d) on %d threads in %.2fs (%.2f Msamples/s)\n",
+            nx, ny, samples / (double(nx) * ny), opt.spp, pool.size(), seconds, samples / seconds * 1e-6);
+    if (settings.noise_threshold > 0) {
+        size_t done = std::count(image.converged.begin(), image.converged.end(), 1);
+        fprintf(stderr, "adaptive: %.1f%% of pixels converged, %.1f%% of the uniform sample budget used\n",
+                100.0 * done / image.converged.size(), 100.0 * samples / (double(nx) * ny * opt.spp));
+    }
+    if (checkpoint) checkpoint->stats.print(checkpoint->file_path().c_str());
+    if (opt.stats) texture_tiles().stats.print(texture_tiles().capacity_bytes());
+
+    if (!finish_outputs(opt, image, world, cam, pool)) return 1;
+#ifdef RT_STATS
+    if (!opt.stats_json.empty()) {
+        if (!render_stats::write_json(opt.stats_json, seconds)) {
+            fprintf(stderr, "failed to write %s\n", opt.stats_json.c_str());
+            return 1;
+        }
+        fprintf(stderr, "wrote %s\n", opt.stats_json.c_str());
+    }
+    if (!opt.trace.empty()) {
+        if (!render_stats::write_trace(opt.trace)) {
+            fprintf(stderr, "failed to write %s\n", opt.trace.c_str());
+            return 1;
+        }
+        fprintf(stderr, "wrote %s\n", opt.trace.c_str());
+    }
+#endif
+    return 0;
 }
 
-int main() {
-    const int nx = 1440;
-    const int ny = 720;
-    // const int ns = 100;
+#ifndef _WIN32
+// --workers: the same render from forked worker processes (see distributed.h);
+// the coordinator only merges, then resolves on a local pool
+int render_headless_distributed(const render_options &opt, const render_settings &settings, hitable *world,
+                                camera &cam, clock_point launched) {
+    film image(opt.nx, opt.ny);
+    distributed_stats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (!render_distributed(image, world, cam, settings, opt.spp, opt.workers, opt.worker_fail_after, stats)) {
+        fprintf(stderr, "could not start any worker process\n");
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double samples = double(image.total_samples());
+    fprintf(stderr, "rendered %dx%d @ %d spp as %d jobs on %d worker processes in %.2fs (%.2f Msamples/s), "
+                    "%.1f ms after launch\n", opt.nx, opt.ny, opt.spp, stats.jobs, stats.workers, seconds,
+            samples / seconds * 1e-6, ms_since(launched));
+    if (stats.workers_lost > 0) {
+        fprintf(stderr, "%d workers lost, %d jobs reassigned, %d rendered by the coordinator\n", stats.workers_lost,
+                stats.jobs_reassigned, stats.jobs_local);
+    }
+    tile_scheduler pool(opt.threads > 0 ? opt.threads : default_thread_count());
+    return finish_outputs(opt, image, world, cam, pool) ? 0 : 1;
+}
+#endif
 
-    InitWindow(nx, ny, "Raytracing");
-    SetTargetFPS(60);
+#ifdef RT_WITH_RAYLIB
+// WASD to move, Q/E down and up, shift to go faster; drag with the left
+// mouse button or use the arrow keys to look around. Yaw is about the y
+// axis, as in the scenes this renders.
+struct fly_controls {
+    vec3 position;
+    float yaw, pitch;       // radians, yaw 0 looks down -z
+    float speed = 1;        // scene units per second
 
-    hitable* list[5];
-    list[0] = new sphere(vec3(0, 0, -1), 0.2, new lambertian(vec3(0.8, 0.3, 0.3)));
-    list[1] = new sphere(vec3(0, -100.5, -1), 100, new lambertian(vec3(0.8, 0.8, 0.0)));
-    list[2] = new cube(vec3(-0.7,0,-1),0.5,new lambertian(vec3(0.2,0.1,0.9)));
-    list[3] = new cube(vec3(0.0,0,-1),0.5,new dielectric(1.5));
-    list[4] = new sphere(vec3(0.5,0,-1.2),0.2,new metal(vec3(0.0,1,0.7),0.1));
-    hitable* world = new hitable_list(list, 5);
+    explicit fly_controls(const camera &cam) : position(cam.origin) {
+        vec3 forward = -cam.w;
+        yaw = std::atan2(forward.x(), -forward.z());
+        pitch = std::asin(std::clamp(forward.y(), -1.0f, 1.0f));
+    }
 
-    Image img = GenImageColor(nx, ny, BLACK);
-    Color* pixels = (Color*)img.data;
-    float aspect = float(nx) / float(ny);
-    vec3 lookfrom(1,0.5,-0.5);
-    vec3 lookat(0,0,-1);
-    vec3 vup(0,1,0);
-    float fov = 45;
+    vec3 forward() const {
+        return vec3(std::cos(pitch) * std::sin(yaw), std::sin(pitch), -std::cos(pitch) * std::cos(yaw));
+    }
 
-    camera cam(lookfrom, lookat, vup, fov, aspect);
+    // applies this frame's input to cam, true if it changed
+    bool update(camera &cam, float dt) {
+        const float look_speed = 1.5f;      // radians per second with the arrow keys
+        const float mouse_speed = 0.005f;   // radians per pixel dragged
+        float step = speed * dt * (IsKeyDown(KEY_LEFT_SHIFT) ? 5.0f : 1.0f);
+        vec3 ahead = forward();
+        vec3 right = unit_vector(cross(ahead, cam.vup));
+        vec3 move(0, 0, 0);
+        if (IsKeyDown(KEY_W)) move += ahead;
+        if (IsKeyDown(KEY_S)) move -= ahead;
+        if (IsKeyDown(KEY_D)) move += right;
+        if (IsKeyDown(KEY_A)) move -= right;
+        if (IsKeyDown(KEY_E)) move += cam.vup;
+        if (IsKeyDown(KEY_Q)) move -= cam.vup;
 
+        float turn = 0, tilt = 0;
+        if (IsKeyDown(KEY_RIGHT)) turn += look_speed * dt;
+        if (IsKeyDown(KEY_LEFT)) turn -= look_speed * dt;
+        if (IsKeyDown(KEY_UP)) tilt += look_speed * dt;
+        if (IsKeyDown(KEY_DOWN)) tilt -= look_speed * dt;
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+            Vector2 delta = GetMouseDelta();
+            turn += delta.x * mouse_speed;
+            tilt -= delta.y * mouse_speed;
+        }
+        if (move.squared_length() == 0 && turn == 0 && tilt == 0) return false;
 
-    Texture2D texture = LoadTextureFromImage(img);
+        position += move * step;
+        yaw += turn;
+        pitch = std::clamp(pitch + tilt, -1.5f, 1.5f);     // never straight up, where vup is degenerate
+        cam = cam.moved(position, position + forward());
+        return true;
+    }
+};
 
-    std::vector<vec3> accum(nx * ny, vec3(0,0,0)); // buffer
-    int sample_count = 0;
+// The window only presents; rendering runs on its own thread (see
+// progressive_renderer). The camera moves with fly_controls, the renderer
+// reprojects what it has into each new view. R reloads the scene: reload()
+// returns the new world (and moves cam), or nullptr to keep the current one.
+int render_window(const render_options &opt, const render_settings &settings, hitable *world, camera &cam,
+                  tile_scheduler &pool, clock_point launched, const std::function<hitable *(camera &)> &reload,
+                  checkpoint_file *checkpoint) {
+    const int nx = opt.nx;
+    const int ny = opt.ny;
 
-    while (!WindowShouldClose()) {
-        sample_count++;
+    InitWindow(nx, ny, "Raytracing");
+    SetTargetFPS(60);
 
-        // render one frame per frame
-        render_pass(pixels, accum, nx, ny, world, cam, sample_count);
+    Image img = GenImageColor(nx, ny, BLACK);
+    Texture2D texture = LoadTextureFromImage(img);
+    UnloadImage(img);
 
-        UpdateTexture(texture, pixels);
+    {
+        auto renderer =
+            std::make_unique<progressive_renderer>(pool, world, cam, settings, opt.display, nx, ny, checkpoint);
+        fly_controls controls(cam);
+        bool first_frame = true;
+        bool denoise = opt.denoise;
+        renderer->set_denoise(denoise);
+        while (!WindowShouldClose()) {
+            if (IsKeyPressed(KEY_R)) {
+                renderer.reset();   // nothing may trace the old world while it is replaced
+                clock_point start = std::chrono::steady_clock::now();
+                if (hitable *next = reload(cam)) {
+                    world = next;
+                    fprintf(stderr, "reloaded in %.1f ms\n", ms_since(start));
+                } else {
+                    fprintf(stderr, "reload failed, keeping the current scene\n");
+                }
+                if (checkpoint) checkpoint->discard();  // a different image from here on
+                renderer =
+                    std::make_unique<progressive_renderer>(pool, world, cam, settings, opt.display, nx, ny, checkpoint);
+                controls = fly_controls(cam);
+                renderer->set_denoise(denoise);
+            }
+            if (controls.update(cam, GetFrameTime())) renderer->move_camera(cam);
+            if (IsKeyPressed(KEY_N)) renderer->set_denoise(denoise = !denoise);
+            if (renderer->acquire()) {
+                if (first_frame) {
+                    fprintf(stderr, "startup: first frame %.1f ms after launch\n", ms_since(launched));
+                    first_frame = false;
+                }
+                UpdateTexture(texture, renderer->latest().pixels.data());
+            }
 
-        BeginDrawing();
-        ClearBackground(BLACK);
-        DrawTexture(texture, 0, 0, WHITE);
-        DrawText(TextFormat("samples done: %d", sample_count), 10, 10, 20, Color(0,0,0,255));
-        EndDrawing();
+            BeginDrawing();
+            ClearBackground(BLACK);
+            DrawTexture(texture, 0, 0, WHITE);
+            const frame_snapshot &shown = renderer->latest();
+            DrawText(TextFormat("samples done: %d%s", shown.samples, shown.denoised ? ", denoised" : ""), 10, 10, 20,
+                     Color(0,0,0,255));
+            if (shown.moves > 0) {
+                DrawText(TextFormat("last move kept %.0f%% of pixels", 100 * shown.reused), 10, 60, 20,
+                         Color(0,0,0,255));
+            }
+#ifdef RT_STATS
+            double mrays = shown.seconds > 0 ? shown.counters.rays / shown.seconds * 1e-6 : 0.0;
+            DrawText(TextFormat("%.2f Mrays/s, %.2f rays/path", mrays, shown.counters.mean_path_length()), 10, 35, 20,
+                     Color(0,0,0,255));
+#endif
+            EndDrawing();
+        }
     }
-    // task_cv.notify_all();
+    if (checkpoint) checkpoint->stats.print(checkpoint->file_path().c_str());
+    if (opt.stats) texture_tiles().stats.print(texture_tiles().capacity_bytes());
 
-    // render_thread.join();
     UnloadTexture(texture);
     CloseWindow();
     return 0;
 }
+#endif
+
+// Fills world with the scene opt names, emptying it first. For a scene file,
+// file.load() into the same world has already run.
+bool build_world(const render_options &opt, scene_file &file, scene &world) {
+    if (!builtin_scene(opt.scene)) {
+        if (!file.build(opt.use_bvh, world)) return false;
+        file.stats.print(opt.scene.c_str());
+        return true;
+    }
+    world.clear();
+    if (opt.scene == "procedural") {
+        procedural_scene(world);
+    } else if (opt.scene == "interior") {
+        interior_scene(world);
+    } else if (opt.scene == "spheres") {
+        sphere_field(world, opt.count, opt.seed);
+    } else if (opt.scene == "cubes") {
+        cube_field(world, opt.count, opt.seed);
+    } else if (opt.scene == "mesh") {
+        if (!mesh_scene(world, opt.obj, opt.count, opt.stats)) return false;
+    } else {
+        default_scene(world);
+    }
+    world.build(opt.use_bvh);
+    return true;
+}
+
+camera make_camera(const scene_camera &view, float aspect) {
+    return camera(view.lookfrom, view.lookat, view.vup, view.fov, aspect);
+}
+
+int main(int argc, char **argv) {
+    clock_point launched = std::chrono::steady_clock::now();
+    render_options opt;
+    if (!parse_options(argc, argv, opt)) return 1;
+
+    // two, so a reload can build the next world while the current one is still shown
+    scene scenes[2];
+    scene *world = &scenes[0];
+    scene_file file;
+    if (!builtin_scene(opt.scene)) {
+        if (!file.load(opt.scene, opt.scene_cache, *world)) return 1;
+        // a scene file may carry settings, which go before the command line so it can override them
+        if (!file.settings.empty()) {
+            std::vector<char *> args = {argv[0]};
+            for (std::string &s : file.settings) args.push_back(s.data());
+            args.insert(args.end(), argv + 1, argv + argc);
+            opt = render_options();
+            if (!parse_options((int)args.size(), args.data(), opt)) return 1;
+        }
+    }
+
+    const int nx = opt.nx;
+    const int ny = opt.ny;
+    if (!opt.simd.empty() && !select_simd(opt.simd.c_str())) {
+        fprintf(stderr, "simd level %s is not available on this cpu/build\n", opt.simd.c_str());
+        return 1;
+    }
+    if (opt.stats) fprintf(stderr, "simd kernels: %s\n", simd.name);
+
+    texture_tiles().set_capacity(size_t(opt.texture_cache) << 20);    // before any tile is read
+    if (!build_world(opt, file, *world)) return 1;
+    if (opt.stats) world->print_stats();
+    fprintf(stderr, "startup: scene ready %.1f ms after launch\n", ms_since(launched));
+
+    float aspect = float(nx) / float(ny);
+    camera cam = make_camera(file.camera, aspect);     // the built-in view unless a scene file moved it
+
+    if (opt.stats) print_traversal_stats(*world, cam, nx, ny);
+
+    render_settings settings;
+    settings.seed = opt.seed;
+    settings.integrator = opt.wavefront ? integrator_wavefront : integrator_path;
+    settings.bounces = opt.bounces;
+    settings.noise_threshold = opt.noise_threshold;
+    settings.min_samples = opt.min_spp;
+    settings.samples_per_pass = opt.samples_per_pass > 0 ? opt.samples_per_pass : opt.headless ? 8 : 1;
+    settings.sampling = opt.sampling;
+    settings.sample_count = opt.spp;
+
+    if (opt.workers > 0) {
+#ifndef _WIN32
+        if (!opt.headless) fprintf(stderr, "--workers renders headless\n");
+        if (settings.noise_threshold > 0) fprintf(stderr, "--workers ignores --noise-threshold, sampling uniformly\n");
+        if (!opt.checkpoint.empty()) fprintf(stderr, "--workers does not checkpoint\n");
+        settings.noise_threshold = 0;
+        return render_headless_distributed(opt, settings, world, cam, launched);   // forks, so before any thread
+#else
+        fprintf(stderr, "--workers needs fork and unix sockets\n");
+        return 1;
+#endif
+    }
+    tile_scheduler pool(opt.threads > 0 ? opt.threads : default_thread_count());
+    std::unique_ptr<checkpoint_file> checkpoint = open_checkpoint(opt, file, settings);
+    if (!opt.checkpoint.empty() && !checkpoint) return 1;
+
+#ifdef RT_WITH_RAYLIB
+    // the scene's settings are only read at startup; a reload picks up geometry, materials and camera
+    auto reload = [&](camera &c) -> hitable * {
+        scene *next = world == &scenes[0] ? &scenes[1] : &scenes[0];
+        if (!builtin_scene(opt.scene) && !file.load(opt.scene, opt.scene_cache, *next)) return nullptr;
+        if (!build_world(opt, file, *next)) return nullptr;
+        world->clear();     // its arena memory serves the reload after this one
+        world = next;
+        c = make_camera(file.camera, aspect);
+        return world;
+    };
+    if (!opt.headless) return render_window(opt, settings, world, cam, pool, launched, reload, checkpoint.get());
+#endif
+    return render_headless(opt, settings, world, cam, pool, launched, checkpoint.get());
+}
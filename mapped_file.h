@@ -0,0 +1,106 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_MAPPED_FILE_H
+#define CPU_CPP_RAYTRACING_MAPPED_FILE_H
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// size and modification time of a file, so caches built from it can tell
+// when it changed; empty if it cannot be read
+std::string file_stamp(const std::string &file) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(file, ec);
+    if (ec) return "";
+    auto mtime = std::filesystem::last_write_time(file, ec);
+    if (ec) return "";
+    return std::to_string(size) + "\t" + std::to_string(mtime.time_since_epoch().count()) + "\t" + file + "\n";
+}
+
+// Read-only view of a whole file. On POSIX the file is memory-mapped so
+// nothing is copied; elsewhere it is read into memory in one go. Files that
+// are parsed front to back should be opened sequential, files that are
+// traced in place (compiled scenes) not, so the kernel reads them ahead
+// without dropping pages behind the reader.
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    ~mapped_file() { close(); }
+
+    bool open(const std::string &path, bool sequential = true) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)st.st_size;
+        if (length > 0) {
+            void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(p, length, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+            mapping = (const char *)p;
+        }
+        ::close(fd);
+        return true;
+#else
+        FILE *f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long n = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buffer.resize(n > 0 ? n : 0);
+        bool ok = fread(buffer.data(), 1, buffer.size(), f) == buffer.size();
+        fclose(f);
+        length = ok ? buffer.size() : 0;
+        return ok;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (mapping) munmap((void *)mapping, length);
+        mapping = nullptr;
+#else
+        buffer.clear();
+#endif
+        length = 0;
+    }
+
+    const char *data() const {
+#ifndef _WIN32
+        return mapping;
+#else
+        return buffer.data();
+#endif
+    }
+    size_t size() const { return length; }
+
+private:
+    size_t length = 0;
+#ifndef _WIN32
+    const char *mapping = nullptr;
+#else
+    std::vector<char> buffer;
+#endif
+};
+
+#endif //CPU_CPP_RAYTRACING_MAPPED_FILE_H
@@ -4,14 +4,49 @@
 
 #ifndef CPU_CPP_RAYTRACING_MATERIAL_H
 #define CPU_CPP_RAYTRACING_MATERIAL_H
+#include "vec3.h"
 
 struct hit_record;
-class vec3;
 class ray;
+class sampler;
+
+// lets batched integrators group hits by material class and call the concrete
+// scatter directly; anything else is shaded through the virtual call
+enum material_type {
+    material_other,
+    material_lambertian,
+    material_metal,
+    material_dielectric,
+    material_light,         // diffuse_light: emits and never scatters
+    material_type_count
+};
+
+// for command line settings and stats
+const char *const material_type_names[material_type_count] = {"other", "lambertian", "metal", "dielectric", "light"};
 
 class material {
 public:
-    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const = 0;
+    const material_type type;
+    explicit material(material_type t = material_other) : type(t) {}
+    virtual ~material() = default;
+    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered, sampler& s) const = 0;
+    // the color the surface gives what it scatters, for the denoiser's albedo buffer
+    virtual vec3 surface_albedo(const hit_record&) const { return vec3(1, 1, 1); }
+    // how much wider (radians) the cone of a ray it scatters gets: 0 for
+    // mirrors and glass, about 1 for diffuse surfaces (see ray_cone)
+    virtual float scatter_spread() const { return 0; }
+
+    // For direct light sampling (see light.h). A material whose scatter()
+    // draws from a density it can evaluate says so here; then eval() is the
+    // BSDF times the cosine at the surface for the unit direction wi, and
+    // pdf() the solid angle density with which scatter() would pick wi.
+    // Mirrors and glass leave all three alone and only see lights by
+    // scattering into them.
+    virtual bool samples_lights() const { return false; }
+    virtual vec3 eval(const ray&, const hit_record&, const vec3&) const { return vec3(0, 0, 0); }
+    virtual float pdf(const ray&, const hit_record&, const vec3&) const { return 0; }
+    // radiance leaving the front of the surface, for material_light only
+    virtual vec3 emitted(const hit_record&) const { return vec3(0, 0, 0); }
 };
 
-#endif //CPU_CPP_RAYTRACING_MATERIAL_H
\ No newline at end of file
+#endif //CPU_CPP_RAYTRACING_MATERIAL_H
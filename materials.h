@@ -8,6 +8,7 @@
 #include "hitable.h"
 #include "material.h"
 #include "ray.h"
+#include "texture.h"
 #include "vec3.h"
 
 class ray;
@@ -17,32 +18,73 @@ vec3 reflect(const vec3 &v, const vec3 &n) {
     return v - 2 * dot(v, n) * n;
 }
 
+// Lambertian and metal take their albedo from a texture when they have one
+// (image textures for assets, noise textures), otherwise the constant.
 class lambertian : public material {
 public:
     vec3 albedo;
-    lambertian(const vec3 &a) : albedo(a) {}
-    virtual bool scatter(const ray &r_in, const hit_record &rec, vec3 &attenuation, ray &scattered) const {
-        vec3 target = rec.p + rec.normal + random_in_unit_sphere();
-        scattered = ray(rec.p, target - rec.p);
-        attenuation = albedo;
+    const texture *albedo_texture = nullptr;
+    lambertian(const vec3 &a) : material(material_lambertian), albedo(a) {}
+    lambertian(const texture *t) : material(material_lambertian), albedo(1, 1, 1), albedo_texture(t) {}
+    vec3 albedo_at(const hit_record &rec) const { return albedo_texture ? albedo_texture->value(rec) : albedo; }
+    // cosine distributed about the normal
+    virtual bool scatter(const ray &r_in, const hit_record &rec, vec3 &attenuation, ray &scattered, sampler &s) const {
+        scattered = ray(rec.p, sample_cosine_hemisphere(rec.normal, s.next_2d()));
+        attenuation = albedo_at(rec);
         return true;
     }
+    virtual vec3 surface_albedo(const hit_record &rec) const { return albedo_at(rec); }
+    virtual float scatter_spread() const { return 1; }
+    virtual bool samples_lights() const { return true; }
+    virtual vec3 eval(const ray &, const hit_record &rec, const vec3 &wi) const {
+        return albedo_at(rec) * (std::max(0.0f, dot(rec.normal, wi)) / float(M_PI));
+    }
+    virtual float pdf(const ray &, const hit_record &rec, const vec3 &wi) const {
+        return std::max(0.0f, dot(rec.normal, wi)) / float(M_PI);
+    }
 };
 
 class metal : public material {
 public:
     vec3 albedo;
+    const texture *albedo_texture = nullptr;
     float fuzz;
-    metal(const vec3& a, float f) : albedo(a) {
+    metal(const vec3& a, float f) : material(material_metal), albedo(a) {
         if (f < 1) fuzz = f; else fuzz = 1;
     }
+    metal(const texture *t, float f) : metal(vec3(1, 1, 1), f) { albedo_texture = t; }
+    vec3 albedo_at(const hit_record &rec) const { return albedo_texture ? albedo_texture->value(rec) : albedo; }
 
-    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
+    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered, sampler& s) const {
         vec3 reflected = reflect(unit_vector(r_in.direction()),rec.normal);
-        scattered = ray(rec.p, reflected+fuzz*random_in_unit_sphere());
-        attenuation = albedo;
+        scattered = ray(rec.p, reflected+fuzz*random_in_unit_sphere(s));
+        attenuation = albedo_at(rec);
         return dot(scattered.direction(), rec.normal) > 0;
     }
+    virtual vec3 surface_albedo(const hit_record &rec) const { return albedo_at(rec); }
+    virtual float scatter_spread() const { return fuzz; }
+    // a perfect mirror only finds lights by reflecting into them
+    virtual bool samples_lights() const { return fuzz > 0; }
+    // scatter() keeps albedo of what it reflects above the surface
+    virtual vec3 eval(const ray &r_in, const hit_record &rec, const vec3 &wi) const {
+        if (dot(wi, rec.normal) <= 0) return vec3(0, 0, 0);
+        return albedo_at(rec) * pdf(r_in, rec, wi);
+    }
+    // The direction of reflected + fuzz * u for u uniform in the unit ball:
+    // its density is the volume of the fuzz ball along wi, the integral of
+    // t^2 over the chord [t1, t2], over the volume of the ball.
+    virtual float pdf(const ray &r_in, const hit_record &rec, const vec3 &wi) const {
+        vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
+        float b = dot(wi, reflected);
+        // squared half chord, with the sine from the cross product to keep it exact near the mirror direction
+        float half_chord2 = fuzz * fuzz - cross(wi, reflected).squared_length();
+        if (half_chord2 <= 0) return 0;
+        float half_chord = std::sqrt(half_chord2);
+        float t2 = b + half_chord;
+        if (t2 <= 0) return 0;
+        float t1 = std::max(0.0f, b - half_chord);
+        return (t2 - t1) * (t2 * t2 + t2 * t1 + t1 * t1) / (4 * float(M_PI) * fuzz * fuzz * fuzz);
+    }
 };
 
 bool refract(const vec3 & v,const vec3 & outward_normal, float ni_over_nt, vec3 & refracted) {
@@ -65,9 +107,9 @@ float schlick(float cosine, float ref_idx) {
 class dielectric : public material {
 public:
     float refraction_index;
-    dielectric(float ri) : refraction_index(ri) {}
+    dielectric(float ri) : material(material_dielectric), refraction_index(ri) {}
 
-    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
+    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered, sampler& s) const {
         vec3 outward_normal;
         vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
         float ni_over_nt;
@@ -90,7 +132,7 @@ public:
             scattered = ray(rec.p, reflected);
             reflect_prob = 1.0;
         }
-        if (dist(gen) < reflect_prob) {
+        if (s.next_1d() < reflect_prob) {
             scattered = ray(rec.p, reflected);
         } else {
             scattered = ray(rec.p, refracted);
@@ -98,4 +140,46 @@ public:
         return true;
     }
 };
+
+// Bump mapping for any material: tilts the normal by the gradient of a
+// height field, strength / scale times fBm of the hit point times scale,
+// then lets base scatter off the tilted normal.
+class bump : public material {
+public:
+    const material *base;
+    float scale;
+    float strength;
+    fbm_settings settings;
+
+    bump(const material *base, float scale, float strength, const fbm_settings &settings = {})
+        : base(base), scale(scale), strength(strength), settings(settings) {}
+
+    vec3 bumped_normal(const hit_record &rec) const {
+        vec3 gradient;
+        fbm_gradient(rec.p * scale, settings, gradient);
+        gradient *= strength;
+        // only the part along the surface tilts it
+        vec3 tangential = gradient - dot(gradient, rec.normal) * rec.normal;
+        return unit_vector(rec.normal - tangential);
+    }
+
+    virtual bool scatter(const ray &r_in, const hit_record &rec, vec3 &attenuation, ray &scattered, sampler &s) const {
+        hit_record tilted = rec;
+        tilted.normal = bumped_normal(rec);
+        return base->scatter(r_in, tilted, attenuation, scattered, s);
+    }
+    virtual vec3 surface_albedo(const hit_record &rec) const { return base->surface_albedo(rec); }
+    virtual float scatter_spread() const { return base->scatter_spread(); }
+    virtual bool samples_lights() const { return base->samples_lights(); }
+    virtual vec3 eval(const ray &r_in, const hit_record &rec, const vec3 &wi) const {
+        hit_record tilted = rec;
+        tilted.normal = bumped_normal(rec);
+        return base->eval(r_in, tilted, wi);
+    }
+    virtual float pdf(const ray &r_in, const hit_record &rec, const vec3 &wi) const {
+        hit_record tilted = rec;
+        tilted.normal = bumped_normal(rec);
+        return base->pdf(r_in, tilted, wi);
+    }
+};
 #endif //CPU_CPP_RAYTRACING_MATERIALS_H
\ No newline at end of file
@@ -0,0 +1,370 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_NOISE_H
+#define CPU_CPP_RAYTRACING_NOISE_H
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "sampler.h"
+#include "simd.h"
+#include "vec3.h"
+
+// 3D gradient noise (Perlin's improved noise: quintic fade, gradients
+// towards the 12 cube edges) and fBm sums of it, all in float. The
+// permutation table is built once from a fixed seed and only read after
+// that, so any thread may evaluate noise at any time.
+//
+// fbm_points() evaluates a batch of points with the kernel for the --simd
+// level, 4 or 8 points per step, for callers with many points at hand.
+// Bump maps need the gradient at one point; fbm_gradient() gets it
+// analytically from a single set of lattice lookups.
+
+struct noise_table {
+    int32_t perm[512];      // a permutation of 0..255, twice, so perm[i + 1] needs no wrap
+};
+
+const noise_table &noise_permutation() {
+    static const noise_table table = [] {
+        noise_table t;
+        for (int i = 0; i < 256; i++) t.perm[i] = i;
+        pcg32 rng;
+        rng.seed(mix64(0x6e6f697365), 3);
+        for (int i = 255; i > 0; i--) std::swap(t.perm[i], t.perm[rng.next_uint() % uint32_t(i + 1)]);
+        for (int i = 0; i < 256; i++) t.perm[256 + i] = t.perm[i];
+        return t;
+    }();
+    return table;
+}
+
+struct fbm_settings {
+    int octaves = 5;
+    float lacunarity = 2;   // frequency factor from one octave to the next
+    float gain = 0.5f;      // amplitude factor from one octave to the next
+};
+
+// each octave is shifted by this much more, so the octaves' lattices do not line up at the origin
+const float octave_offset[3] = {19.19f, 7.31f, 3.77f};
+
+inline float noise_fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+inline float noise_lerp(float t, float a, float b) { return a + t * (b - a); }
+
+// the gradient for hash h is (grad_x, grad_y, grad_z)[h & 15]: the 12 edge
+// directions and 4 of them again, as in the reference implementation
+const float noise_grad_x[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+const float noise_grad_y[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+const float noise_grad_z[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+
+inline float noise_grad(int h, float x, float y, float z) {
+    h &= 15;
+    return noise_grad_x[h] * x + noise_grad_y[h] * y + noise_grad_z[h] * z;
+}
+
+// floor without a libm call (the baseline has no SSE4.1 round)
+inline int noise_floor(float x) {
+    int i = int(x);
+    return i - (x < float(i));
+}
+
+inline float gradient_noise(const int32_t *perm, float x, float y, float z) {
+    int ix = noise_floor(x), iy = noise_floor(y), iz = noise_floor(z);
+    int X = ix & 255, Y = iy & 255, Z = iz & 255;
+    x -= float(ix);
+    y -= float(iy);
+    z -= float(iz);
+    float u = noise_fade(x), v = noise_fade(y), w = noise_fade(z);
+    int A = perm[X] + Y, AA = perm[A] + Z, AB = perm[A + 1] + Z;
+    int B = perm[X + 1] + Y, BA = perm[B] + Z, BB = perm[B + 1] + Z;
+    return noise_lerp(w, noise_lerp(v, noise_lerp(u, noise_grad(perm[AA], x, y, z), noise_grad(perm[BA], x - 1, y, z)),
+                                       noise_lerp(u, noise_grad(perm[AB], x, y - 1, z),
+                                                  noise_grad(perm[BB], x - 1, y - 1, z))),
+                      noise_lerp(v, noise_lerp(u, noise_grad(perm[AA + 1], x, y, z - 1),
+                                               noise_grad(perm[BA + 1], x - 1, y, z - 1)),
+                                 noise_lerp(u, noise_grad(perm[AB + 1], x, y - 1, z - 1),
+                                            noise_grad(perm[BB + 1], x - 1, y - 1, z - 1))));
+}
+
+// in about [-1, 1], 0 at every lattice point
+inline float gradient_noise(const vec3 &p) {
+    return gradient_noise(noise_permutation().perm, p.x(), p.y(), p.z());
+}
+
+// sum of octaves over the sum of their amplitudes, so also in about [-1, 1]
+inline float fbm_point(const int32_t *perm, float x, float y, float z, const fbm_settings &s) {
+    float sum = 0, total = 0, amplitude = 1, frequency = 1;
+    for (int k = 0; k < s.octaves; k++) {
+        sum += amplitude * gradient_noise(perm, x * frequency + k * octave_offset[0],
+                                          y * frequency + k * octave_offset[1], z * frequency + k * octave_offset[2]);
+        total += amplitude;
+        amplitude *= s.gain;
+        frequency *= s.lacunarity;
+    }
+    return total > 0 ? sum / total : 0;
+}
+
+inline float fbm(const vec3 &p, const fbm_settings &s) {
+    return fbm_point(noise_permutation().perm, p.x(), p.y(), p.z(), s);
+}
+
+// gradient_noise() and its gradient in d, from the same lookups: the
+// trilinear blend of the corner gradients plus the fade derivatives times
+// the corner values' differences
+inline float gradient_noise_d(const int32_t *perm, float x, float y, float z, float d[3]) {
+    int ix = noise_floor(x), iy = noise_floor(y), iz = noise_floor(z);
+    int X = ix & 255, Y = iy & 255, Z = iz & 255;
+    x -= float(ix);
+    y -= float(iy);
+    z -= float(iz);
+    float u = noise_fade(x), v = noise_fade(y), w = noise_fade(z);
+    float du = 30 * x * x * (x - 1) * (x - 1), dv = 30 * y * y * (y - 1) * (y - 1), dw = 30 * z * z * (z - 1) * (z - 1);
+    int A = perm[X] + Y, AA = perm[A] + Z, AB = perm[A + 1] + Z;
+    int B = perm[X + 1] + Y, BA = perm[B] + Z, BB = perm[B + 1] + Z;
+    // corners in x, y, z bit order
+    const int hashes[8] = {perm[AA], perm[BA], perm[AB], perm[BB], perm[AA + 1], perm[BA + 1], perm[AB + 1], perm[BB + 1]};
+    float value[8], gx[8], gy[8], gz[8];
+    for (int c = 0; c < 8; c++) {
+        int h = hashes[c] & 15;
+        gx[c] = noise_grad_x[h];
+        gy[c] = noise_grad_y[h];
+        gz[c] = noise_grad_z[h];
+        value[c] = gx[c] * (x - (c & 1)) + gy[c] * (y - ((c >> 1) & 1)) + gz[c] * (z - (c >> 2));
+    }
+    auto blend = [&](const float *k) {
+        return k[0] + u * (k[1] - k[0]) + v * (k[2] - k[0]) + w * (k[4] - k[0]) +
+               u * v * (k[0] - k[1] - k[2] + k[3]) + v * w * (k[0] - k[2] - k[4] + k[6]) +
+               w * u * (k[0] - k[1] - k[4] + k[5]) + u * v * w * (-k[0] + k[1] + k[2] - k[3] + k[4] - k[5] - k[6] + k[7]);
+    };
+    const float *k = value;
+    float k1 = k[1] - k[0], k2 = k[2] - k[0], k3 = k[4] - k[0];
+    float k4 = k[0] - k[1] - k[2] + k[3], k5 = k[0] - k[2] - k[4] + k[6], k6 = k[0] - k[1] - k[4] + k[5];
+    float k7 = -k[0] + k[1] + k[2] - k[3] + k[4] - k[5] - k[6] + k[7];
+    d[0] = blend(gx) + du * (k1 + k4 * v + k6 * w + k7 * v * w);
+    d[1] = blend(gy) + dv * (k2 + k5 * w + k4 * u + k7 * w * u);
+    d[2] = blend(gz) + dw * (k3 + k6 * u + k5 * v + k7 * u * v);
+    return blend(value);
+}
+
+// fbm() and its gradient, about as fast as two fbm() lookups where a
+// forward difference would take four
+inline float fbm_gradient(const vec3 &p, const fbm_settings &s, vec3 &gradient) {
+    const int32_t *perm = noise_permutation().perm;
+    float sum = 0, total = 0, amplitude = 1, frequency = 1;
+    float g[3] = {0, 0, 0};
+    for (int k = 0; k < s.octaves; k++) {
+        float d[3];
+        sum += amplitude * gradient_noise_d(perm, p.x() * frequency + k * octave_offset[0],
+                                            p.y() * frequency + k * octave_offset[1],
+                                            p.z() * frequency + k * octave_offset[2], d);
+        for (int a = 0; a < 3; a++) g[a] += amplitude * frequency * d[a];
+        total += amplitude;
+        amplitude *= s.gain;
+        frequency *= s.lacunarity;
+    }
+    float scale = total > 0 ? 1 / total : 0;
+    gradient = vec3(g[0], g[1], g[2]) * scale;
+    return sum * scale;
+}
+
+// out[i] = fbm of (x[i], y[i], z[i]) for i < count
+typedef void (*fbm_kernel)(const int32_t *perm, const float *x, const float *y, const float *z, int count,
+                           const fbm_settings &s, float *out);
+
+void fbm_scalar(const int32_t *perm, const float *x, const float *y, const float *z, int count,
+                const fbm_settings &s, float *out) {
+    for (int i = 0; i < count; i++) out[i] = fbm_point(perm, x[i], y[i], z[i], s);
+}
+
+#ifdef RT_SIMD_X86
+// SSE2 only: selects with and/andnot, floor by truncating and correcting,
+// the table lookups one lane at a time
+inline __m128 noise_select_sse(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128i noise_lookup_sse(const int32_t *perm, __m128i i) {
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128((__m128i *)lanes, i);
+    return _mm_setr_epi32(perm[lanes[0]], perm[lanes[1]], perm[lanes[2]], perm[lanes[3]]);
+}
+
+inline __m128 noise_fade_sse(__m128 t) {
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15))),
+                              _mm_set1_ps(10));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+inline __m128 noise_lerp_sse(__m128 t, __m128 a, __m128 b) { return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a))); }
+
+inline __m128 noise_grad_sse(__m128i h, __m128 x, __m128 y, __m128 z) {
+    h = _mm_and_si128(h, _mm_set1_epi32(15));
+    __m128 below8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+    __m128 below4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    __m128 takes_x = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+                                                   _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+    __m128 u = noise_select_sse(below8, x, y);
+    __m128 v = noise_select_sse(below4, y, noise_select_sse(takes_x, x, z));
+    __m128 sign_u = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+    __m128 sign_v = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, sign_u), _mm_xor_ps(v, sign_v));
+}
+
+inline __m128 noise_floor_sse(__m128 x) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1)));
+}
+
+inline __m128 gradient_noise_sse(const int32_t *perm, __m128 x, __m128 y, __m128 z) {
+    __m128 fx = noise_floor_sse(x), fy = noise_floor_sse(y), fz = noise_floor_sse(z);
+    const __m128i mask = _mm_set1_epi32(255), one = _mm_set1_epi32(1);
+    __m128i X = _mm_and_si128(_mm_cvttps_epi32(fx), mask);
+    __m128i Y = _mm_and_si128(_mm_cvttps_epi32(fy), mask);
+    __m128i Z = _mm_and_si128(_mm_cvttps_epi32(fz), mask);
+    x = _mm_sub_ps(x, fx);
+    y = _mm_sub_ps(y, fy);
+    z = _mm_sub_ps(z, fz);
+    __m128 u = noise_fade_sse(x), v = noise_fade_sse(y), w = noise_fade_sse(z);
+    __m128i A = _mm_add_epi32(noise_lookup_sse(perm, X), Y);
+    __m128i B = _mm_add_epi32(noise_lookup_sse(perm, _mm_add_epi32(X, one)), Y);
+    __m128i AA = _mm_add_epi32(noise_lookup_sse(perm, A), Z);
+    __m128i AB = _mm_add_epi32(noise_lookup_sse(perm, _mm_add_epi32(A, one)), Z);
+    __m128i BA = _mm_add_epi32(noise_lookup_sse(perm, B), Z);
+    __m128i BB = _mm_add_epi32(noise_lookup_sse(perm, _mm_add_epi32(B, one)), Z);
+    __m128 x1 = _mm_sub_ps(x, _mm_set1_ps(1)), y1 = _mm_sub_ps(y, _mm_set1_ps(1)), z1 = _mm_sub_ps(z, _mm_set1_ps(1));
+    __m128 near_z = noise_lerp_sse(v, noise_lerp_sse(u, noise_grad_sse(noise_lookup_sse(perm, AA), x, y, z),
+                                                     noise_grad_sse(noise_lookup_sse(perm, BA), x1, y, z)),
+                                   noise_lerp_sse(u, noise_grad_sse(noise_lookup_sse(perm, AB), x, y1, z),
+                                                  noise_grad_sse(noise_lookup_sse(perm, BB), x1, y1, z)));
+    __m128 far_z = noise_lerp_sse(
+        v,
+        noise_lerp_sse(u, noise_grad_sse(noise_lookup_sse(perm, _mm_add_epi32(AA, one)), x, y, z1),
+                       noise_grad_sse(noise_lookup_sse(perm, _mm_add_epi32(BA, one)), x1, y, z1)),
+        noise_lerp_sse(u, noise_grad_sse(noise_lookup_sse(perm, _mm_add_epi32(AB, one)), x, y1, z1),
+                       noise_grad_sse(noise_lookup_sse(perm, _mm_add_epi32(BB, one)), x1, y1, z1)));
+    return noise_lerp_sse(w, near_z, far_z);
+}
+
+void fbm_sse(const int32_t *perm, const float *x, const float *y, const float *z, int count, const fbm_settings &s,
+             float *out) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+        __m128 sum = _mm_setzero_ps();
+        float total = 0, amplitude = 1, frequency = 1;
+        for (int k = 0; k < s.octaves; k++) {
+            __m128 f = _mm_set1_ps(frequency);
+            __m128 n = gradient_noise_sse(perm, _mm_add_ps(_mm_mul_ps(px, f), _mm_set1_ps(k * octave_offset[0])),
+                                          _mm_add_ps(_mm_mul_ps(py, f), _mm_set1_ps(k * octave_offset[1])),
+                                          _mm_add_ps(_mm_mul_ps(pz, f), _mm_set1_ps(k * octave_offset[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+            total += amplitude;
+            amplitude *= s.gain;
+            frequency *= s.lacunarity;
+        }
+        _mm_storeu_ps(out + i, _mm_mul_ps(sum, _mm_set1_ps(total > 0 ? 1 / total : 0)));
+    }
+    fbm_scalar(perm, x + i, y + i, z + i, count - i, s, out + i);
+}
+#endif
+
+#ifdef RT_SIMD_AVX2
+RT_TARGET_AVX2 inline __m256 noise_fade_avx(__m256 t) {
+    __m256 inner = _mm256_add_ps(
+        _mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+RT_TARGET_AVX2 inline __m256 noise_lerp_avx(__m256 t, __m256 a, __m256 b) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+RT_TARGET_AVX2 inline __m256 noise_grad_avx(__m256i h, __m256 x, __m256 y, __m256 z) {
+    h = _mm256_and_si256(h, _mm256_set1_epi32(15));
+    __m256 below8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 below4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 takes_x = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                                         _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    __m256 u = _mm256_blendv_ps(y, x, below8);
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, takes_x), y, below4);
+    __m256 sign_u = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    __m256 sign_v = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, sign_u), _mm256_xor_ps(v, sign_v));
+}
+
+RT_TARGET_AVX2 inline __m256 gradient_noise_avx(const int32_t *perm, __m256 x, __m256 y, __m256 z) {
+    __m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+    const __m256i mask = _mm256_set1_epi32(255), one = _mm256_set1_epi32(1);
+    __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+    __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+    __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+    x = _mm256_sub_ps(x, fx);
+    y = _mm256_sub_ps(y, fy);
+    z = _mm256_sub_ps(z, fz);
+    __m256 u = noise_fade_avx(x), v = noise_fade_avx(y), w = noise_fade_avx(z);
+    __m256i A = _mm256_add_epi32(_mm256_i32gather_epi32(perm, X, 4), Y);
+    __m256i B = _mm256_add_epi32(_mm256_i32gather_epi32(perm, _mm256_add_epi32(X, one), 4), Y);
+    __m256i AA = _mm256_add_epi32(_mm256_i32gather_epi32(perm, A, 4), Z);
+    __m256i AB = _mm256_add_epi32(_mm256_i32gather_epi32(perm, _mm256_add_epi32(A, one), 4), Z);
+    __m256i BA = _mm256_add_epi32(_mm256_i32gather_epi32(perm, B, 4), Z);
+    __m256i BB = _mm256_add_epi32(_mm256_i32gather_epi32(perm, _mm256_add_epi32(B, one), 4), Z);
+    __m256 x1 = _mm256_sub_ps(x, _mm256_set1_ps(1)), y1 = _mm256_sub_ps(y, _mm256_set1_ps(1));
+    __m256 z1 = _mm256_sub_ps(z, _mm256_set1_ps(1));
+    __m256 near_z = noise_lerp_avx(
+        v,
+        noise_lerp_avx(u, noise_grad_avx(_mm256_i32gather_epi32(perm, AA, 4), x, y, z),
+                       noise_grad_avx(_mm256_i32gather_epi32(perm, BA, 4), x1, y, z)),
+        noise_lerp_avx(u, noise_grad_avx(_mm256_i32gather_epi32(perm, AB, 4), x, y1, z),
+                       noise_grad_avx(_mm256_i32gather_epi32(perm, BB, 4), x1, y1, z)));
+    __m256 far_z = noise_lerp_avx(
+        v,
+        noise_lerp_avx(u, noise_grad_avx(_mm256_i32gather_epi32(perm, _mm256_add_epi32(AA, one), 4), x, y, z1),
+                       noise_grad_avx(_mm256_i32gather_epi32(perm, _mm256_add_epi32(BA, one), 4), x1, y, z1)),
+        noise_lerp_avx(u, noise_grad_avx(_mm256_i32gather_epi32(perm, _mm256_add_epi32(AB, one), 4), x, y1, z1),
+                       noise_grad_avx(_mm256_i32gather_epi32(perm, _mm256_add_epi32(BB, one), 4), x1, y1, z1)));
+    return noise_lerp_avx(w, near_z, far_z);
+}
+
+// a tail of 4 or more goes through the SSE kernel
+RT_TARGET_AVX2 void fbm_avx2(const int32_t *perm, const float *x, const float *y, const float *z, int count,
+                             const fbm_settings &s, float *out) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+        __m256 sum = _mm256_setzero_ps();
+        float total = 0, amplitude = 1, frequency = 1;
+        for (int k = 0; k < s.octaves; k++) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 n = gradient_noise_avx(
+                perm, _mm256_add_ps(_mm256_mul_ps(px, f), _mm256_set1_ps(k * octave_offset[0])),
+                _mm256_add_ps(_mm256_mul_ps(py, f), _mm256_set1_ps(k * octave_offset[1])),
+                _mm256_add_ps(_mm256_mul_ps(pz, f), _mm256_set1_ps(k * octave_offset[2])));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(n, _mm256_set1_ps(amplitude)));
+            total += amplitude;
+            amplitude *= s.gain;
+            frequency *= s.lacunarity;
+        }
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(sum, _mm256_set1_ps(total > 0 ? 1 / total : 0)));
+    }
+    fbm_sse(perm, x + i, y + i, z + i, count - i, s, out + i);
+}
+#endif
+
+fbm_kernel fbm_kernel_for(simd_level level) {
+    switch (level) {
+#ifdef RT_SIMD_AVX2
+        case simd_avx2: return fbm_avx2;
+#endif
+#ifdef RT_SIMD_X86
+        case simd_sse: return fbm_sse;
+#endif
+        default: return fbm_scalar;
+    }
+}
+
+// fBm of count points given as separate coordinate arrays, with the kernel for the --simd level
+inline void fbm_points(const float *x, const float *y, const float *z, int count, const fbm_settings &s, float *out) {
+    fbm_kernel_for(simd.level)(noise_permutation().perm, x, y, z, count, s, out);
+}
+
+#endif //CPU_CPP_RAYTRACING_NOISE_H
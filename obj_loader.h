@@ -0,0 +1,117 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_OBJ_LOADER_H
+#define CPU_CPP_RAYTRACING_OBJ_LOADER_H
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "vec3.h"
+
+struct obj_load_stats {
+    size_t file_bytes = 0;
+    size_t vertices = 0;
+    size_t triangles = 0;
+    double load_ms = 0;
+
+    void print(const char *name) const {
+        fprintf(stderr, "%s: %zu vertices, %zu triangles, %.1f MB parsed in %.1f ms (%.0f MB/s)\n", name, vertices,
+                triangles, file_bytes / 1e6, load_ms, load_ms > 0 ? file_bytes / 1e3 / load_ms : 0.0);
+    }
+};
+
+const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+const char *skip_line(const char *p, const char *end) {
+    while (p < end && *p != '\n') p++;
+    return p < end ? p + 1 : end;
+}
+
+// Only positions and faces are read ("v" and "f"); texture coordinates,
+// normals, groups and materials are skipped. Polygons are fan triangulated,
+// negative (relative) indices are supported. The file is parsed in place from
+// the mapping, the only allocations are the two output arrays and one face
+// buffer that grows to the largest polygon.
+bool load_obj(const std::string &path, std::vector<vec3> &positions, std::vector<uint32_t> &indices,
+              obj_load_stats *stats = nullptr) {
+    auto start = std::chrono::steady_clock::now();
+    mapped_file file;
+    if (!file.open(path)) {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        return false;
+    }
+    positions.clear();
+    indices.clear();
+    // rough guess from typical line lengths, saves most of the regrowth
+    positions.reserve(file.size() / 64);
+    indices.reserve(file.size() / 16);
+
+    const char *p = file.data();
+    const char *end = p + file.size();
+    int line = 1;
+    std::vector<uint32_t> face;     // indices of the current face, reused
+    for (; p < end; p = skip_line(p, end), line++) {
+        p = skip_spaces(p, end);
+        if (end - p < 2 || (p[1] != ' ' && p[1] != '\t')) continue;
+
+        if (p[0] == 'v') {
+            float xyz[3];
+            p += 2;
+            for (float &c : xyz) {
+                p = skip_spaces(p, end);
+                auto res = std::from_chars(p, end, c);
+                if (res.ec != std::errc()) {
+                    fprintf(stderr, "%s:%d: bad vertex\n", path.c_str(), line);
+                    return false;
+                }
+                p = res.ptr;
+            }
+            positions.emplace_back(xyz[0], xyz[1], xyz[2]);
+        } else if (p[0] == 'f') {
+            face.clear();
+            p += 2;
+            while (true) {
+                p = skip_spaces(p, end);
+                if (p >= end || *p == '\n' || *p == '\r' || *p == '#') break;
+                long long index;
+                auto res = std::from_chars(p, end, index);
+                if (res.ec != std::errc()) {
+                    fprintf(stderr, "%s:%d: bad face\n", path.c_str(), line);
+                    return false;
+                }
+                p = res.ptr;
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') p++; // skip /vt/vn
+                if (index < 0) index += (long long)positions.size();
+                else index -= 1;
+                if (index < 0 || index >= (long long)positions.size()) {
+                    fprintf(stderr, "%s:%d: face index out of range\n", path.c_str(), line);
+                    return false;
+                }
+                face.push_back((uint32_t)index);
+            }
+            for (size_t k = 2; k < face.size(); k++) {
+                indices.push_back(face[0]);
+                indices.push_back(face[k - 1]);
+                indices.push_back(face[k]);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->file_bytes = file.size();
+        stats->vertices = positions.size();
+        stats->triangles = indices.size() / 3;
+        stats->load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
+
+#endif //CPU_CPP_RAYTRACING_OBJ_LOADER_H
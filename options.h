@@ -0,0 +1,248 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_OPTIONS_H
+#define CPU_CPP_RAYTRACING_OPTIONS_H
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "integrator.h"
+#include "resolve.h"
+#include "sampler.h"
+
+struct render_options {
+    int nx = 1440;
+    int ny = 720;
+    int spp = 100;      // samples per pixel for headless renders
+    int threads = 0;    // 0 = one per hardware thread
+    uint64_t seed = 0;  // same seed + settings = same image, whatever the thread count
+    std::string output = "render.png";
+    std::string scene = "default";  // default | procedural | interior | spheres | cubes | mesh, or a scene file (see scene_file.h)
+    bool scene_cache = true;        // map / write FILE.bin next to a scene file
+    int count = 10000;              // spheres / triangles for the generated scenes
+    std::string obj;                // mesh for --scene mesh
+    bool use_bvh = true;
+    bool stats = false;
+    std::string simd;               // empty = best the cpu supports
+    bool wavefront = false;         // batched per-tile integrator instead of one path at a time
+    sampler_type sampling = sampler_sobol;
+    bounce_policy bounces;
+    float noise_threshold = 0;      // adaptive sampling, 0 = uniform
+    int min_spp = 16;
+    std::string heatmap;            // samples per pixel image, headless only
+    int samples_per_pass = 0;       // 0 = 1 in a window, 8 headless
+    resolve_settings display;       // exposure and tone curve for the window and 8 bit files
+    std::string stats_json;         // render counters, RT_STATS builds, headless only
+    std::string trace;              // tile timings as a chrome trace, likewise
+    int workers = 0;                // worker processes, 0 = render in this process
+    int worker_fail_after = -1;     // testing: the first worker dies after this many jobs
+    std::string checkpoint;         // film snapshots, see checkpoint.h
+    float checkpoint_interval = 60; // seconds between snapshots
+    bool resume = false;            // continue from the checkpoint
+    bool denoise = false;           // filter the output with the albedo/normal/depth buffers
+    std::string aovs;               // write those buffers as PREFIX_albedo.pfm etc., headless only
+    int texture_cache = 256;        // MB of image texture tiles in memory
+#ifdef RT_WITH_RAYLIB
+    bool headless = false;
+#else
+    bool headless = true;
+#endif
+};
+
+void print_usage(const char *exe) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --headless          render without a window and write --output\n"
+            "  --width N           image width (default 1440)\n"
+            "  --height N          image height (default 720)\n"
+            "  --spp N             samples per pixel in headless mode (default 100), the maximum when adaptive\n"
+            "  --threads N         render threads (default: hardware threads)\n"
+            "  --seed N            random seed (default 0)\n"
+            "  --output FILE       .ppm, .png, .pfm or .exr (default render.png)\n"
+            "  --scene NAME|FILE   default | procedural | interior | spheres | cubes | mesh, or a scene file\n"
+            "                      (default: default; procedural has noise textures and bump maps,\n"
+            "                      interior is a closed room lit by area lights,\n"
+            "                      cubes is --count instances of one shared cube mesh)\n"
+            "  --no-scene-cache    always parse and build a scene file, do not read or write FILE.bin\n"
+            "  --count N           spheres or cubes for --scene spheres|cubes, triangles for a generated mesh\n"
+            "                      (default 10000)\n"
+            "  --obj FILE          OBJ file for --scene mesh (default: a generated sphere mesh)\n"
+            "  --accel NAME        bvh | list: per-type BVHs or plain packet loops (default bvh)\n"
+            "  --stats             print acceleration structure build and traversal stats\n"
+            "  --simd LEVEL        scalar | sse | avx2 intersection kernels (default: best available)\n"
+            "  --integrator NAME   path | wavefront: one path at a time or per-tile batches (default path)\n"
+            "  --sampler NAME      independent | stratified | sobol | blue-noise (default sobol); stratified\n"
+            "                      lays its strata out for --spp samples\n"
+            "  --max-depth [M=]N   no scattering after N bounces, for all materials or material M (default 50)\n"
+            "  --min-depth [M=]N   russian roulette after N bounces, for all materials or material M (default 3)\n"
+            "  --rr-threshold X    russian roulette for paths with a throughput below X (default 0.25)\n"
+            "  --no-rr             disable russian roulette\n"
+            "                      materials: lambertian | metal | dielectric | other\n"
+            "  --noise-threshold X adaptive sampling: pixels stop once their estimated error in display\n"
+            "                      units drops below X, e.g. 0.004 for about one 8-bit step (default 0 = off)\n"
+            "  --min-spp N         samples before a pixel may stop (default 16)\n"
+            "  --heatmap FILE      write the samples taken per pixel as an image\n"
+            "  --samples-per-pass N\n"
+            "                      samples per pixel between two displayed snapshots or convergence\n"
+            "                      tests (default 1 in a window, 8 headless)\n"
+            "  --exposure EV       exposure in stops, also applied to .pfm/.exr (default 0)\n"
+            "  --tonemap NAME      clamp | reinhard | aces (default clamp)\n"
+            "  --gamma G           display gamma (default 2)\n"
+            "  --stats-json FILE   write ray, primitive test, scatter and path length counters as JSON\n"
+            "  --trace FILE        write per-tile timings as a chrome://tracing file\n"
+            "                      (both need a build with -DRT_STATS=ON)\n"
+            "  --workers N         render headless in N forked worker processes, tile by tile\n"
+            "  --worker-fail-after N\n"
+            "                      testing: the first worker exits after N jobs, its jobs are reassigned\n"
+            "  --checkpoint FILE   keep a snapshot of the render in FILE, updated between passes\n"
+            "  --checkpoint-interval S\n"
+            "                      seconds between snapshots (default 60); one is always taken at the end\n"
+            "  --resume            continue from --checkpoint if it holds the same render\n"
+            "  --denoise           edge-aware filtering of the output, guided by first-hit albedo, normal\n"
+            "                      and depth (N toggles it in the window)\n"
+            "  --aovs PREFIX       write those buffers as PREFIX_albedo.pfm, PREFIX_normal.pfm, PREFIX_depth.pfm\n"
+            "  --texture-cache MB  memory for image texture tiles, read from disk as needed (default 256)\n",
+            exe);
+}
+
+// anything else given to --scene is a file
+bool builtin_scene(const std::string &name) {
+    return name == "default" || name == "procedural" || name == "interior" || name == "spheres" || name == "cubes" ||
+           name == "mesh";
+}
+
+// "N" sets the depth for every material class, "dielectric=N" for one
+bool parse_depth(const char *arg, int (&depth)[material_type_count]) {
+    const char *eq = strchr(arg, '=');
+    const char *number = eq ? eq + 1 : arg;
+    char *end;
+    long value = strtol(number, &end, 10);
+    if (end == number || *end || value < 0) return false;
+    if (!eq) {
+        std::fill(depth, depth + material_type_count, int(value));
+        return true;
+    }
+    for (int c = 0; c < material_type_count; c++) {
+        if (std::string(arg, eq) == material_type_names[c]) {
+            depth[c] = int(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_sampler(const char *name, sampler_type &type) {
+    for (int t = 0; t < sampler_type_count; t++) {
+        if (!strcmp(name, sampler_type_names[t])) {
+            type = sampler_type(t);
+            return true;
+        }
+    }
+    return false;
+}
+
+// returns false (after printing the usage) on bad input
+bool parse_options(int argc, char **argv, render_options &opt) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        // the whole value must be a number, and at least min
+        auto int_value = [&](int &out, int min) {
+            if (!has_value) return false;
+            char *end;
+            long value = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end || value < min || value > INT_MAX) return false;
+            out = int(value);
+            return true;
+        };
+        auto float_value = [&](float &out, float min) {
+            if (!has_value) return false;
+            char *end;
+            float value = strtof(argv[++i], &end);
+            if (end == argv[i] || *end || !std::isfinite(value) || value < min) return false;
+            out = value;
+            return true;
+        };
+
+        bool ok = true;
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            print_usage(argv[0]);
+            exit(0);
+        }
+        else if (!strcmp(arg, "--headless")) opt.headless = true;
+        else if (!strcmp(arg, "--width")) ok = int_value(opt.nx, 1);
+        else if (!strcmp(arg, "--height")) ok = int_value(opt.ny, 1);
+        else if (!strcmp(arg, "--spp")) ok = int_value(opt.spp, 1);
+        else if (!strcmp(arg, "--threads")) ok = int_value(opt.threads, 0);
+        else if (!strcmp(arg, "--seed") && has_value) opt.seed = strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(arg, "--output") && has_value) opt.output = argv[++i];
+        else if (!strcmp(arg, "--scene") && has_value) opt.scene = argv[++i];
+        else if (!strcmp(arg, "--no-scene-cache")) opt.scene_cache = false;
+        else if (!strcmp(arg, "--count")) ok = int_value(opt.count, 1);
+        else if (!strcmp(arg, "--obj") && has_value) opt.obj = argv[++i];
+        else if (!strcmp(arg, "--accel") && has_value) {
+            std::string accel = argv[++i];
+            opt.use_bvh = accel == "bvh";
+            ok = opt.use_bvh || accel == "list";
+        }
+        else if (!strcmp(arg, "--stats")) opt.stats = true;
+        else if (!strcmp(arg, "--simd") && has_value) opt.simd = argv[++i];
+        else if (!strcmp(arg, "--integrator") && has_value) {
+            std::string integrator = argv[++i];
+            opt.wavefront = integrator == "wavefront";
+            ok = opt.wavefront || integrator == "path";
+        }
+        else if (!strcmp(arg, "--sampler") && has_value) ok = parse_sampler(argv[++i], opt.sampling);
+        else if (!strcmp(arg, "--max-depth") && has_value) ok = parse_depth(argv[++i], opt.bounces.max_depth);
+        else if (!strcmp(arg, "--min-depth") && has_value) ok = parse_depth(argv[++i], opt.bounces.min_depth);
+        else if (!strcmp(arg, "--rr-threshold")) {
+            ok = float_value(opt.bounces.rr_threshold, 0) && opt.bounces.rr_threshold > 0;
+        }
+        else if (!strcmp(arg, "--no-rr")) opt.bounces.russian_roulette = false;
+        else if (!strcmp(arg, "--noise-threshold")) ok = float_value(opt.noise_threshold, 0);
+        else if (!strcmp(arg, "--min-spp")) ok = int_value(opt.min_spp, 2);
+        else if (!strcmp(arg, "--heatmap") && has_value) opt.heatmap = argv[++i];
+        else if (!strcmp(arg, "--samples-per-pass")) ok = int_value(opt.samples_per_pass, 1);
+        else if (!strcmp(arg, "--exposure")) ok = float_value(opt.display.exposure, -INFINITY);
+        else if (!strcmp(arg, "--tonemap") && has_value) ok = parse_tonemap(argv[++i], opt.display.tonemap);
+        else if (!strcmp(arg, "--gamma")) ok = float_value(opt.display.gamma, 0) && opt.display.gamma > 0;
+        else if (!strcmp(arg, "--stats-json") && has_value) opt.stats_json = argv[++i];
+        else if (!strcmp(arg, "--trace") && has_value) opt.trace = argv[++i];
+        else if (!strcmp(arg, "--workers")) ok = int_value(opt.workers, 0);
+        else if (!strcmp(arg, "--worker-fail-after")) ok = int_value(opt.worker_fail_after, 0);
+        else if (!strcmp(arg, "--checkpoint") && has_value) opt.checkpoint = argv[++i];
+        else if (!strcmp(arg, "--checkpoint-interval")) ok = float_value(opt.checkpoint_interval, 0);
+        else if (!strcmp(arg, "--resume")) opt.resume = true;
+        else if (!strcmp(arg, "--denoise")) opt.denoise = true;
+        else if (!strcmp(arg, "--aovs") && has_value) opt.aovs = argv[++i];
+        else if (!strcmp(arg, "--texture-cache")) ok = int_value(opt.texture_cache, 1);
+        else ok = false;
+
+        if (!ok) {
+            fprintf(stderr, "bad argument: %s\n", arg);
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+#ifndef RT_WITH_RAYLIB
+    opt.headless = true;
+#endif
+    if (opt.resume && opt.checkpoint.empty()) {
+        fprintf(stderr, "--resume needs --checkpoint FILE\n");
+        return false;
+    }
+#ifndef RT_STATS
+    if (!opt.stats_json.empty() || !opt.trace.empty()) {
+        fprintf(stderr, "warning: built without RT_STATS, --stats-json and --trace write nothing\n");
+    }
+#endif
+    return true;
+}
+
+#endif //CPU_CPP_RAYTRACING_OPTIONS_H
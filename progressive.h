@@ -0,0 +1,240 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_PROGRESSIVE_H
+#define CPU_CPP_RAYTRACING_PROGRESSIVE_H
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "checkpoint.h"
+#include "denoise.h"
+#include "film.h"
+#include "hitable.h"
+#include "image_io.h"
+#include "integrator.h"
+#include "render_stats.h"
+#include "renderer.h"
+#include "reprojection.h"
+#include "resolve.h"
+#include "thread_pool.h"
+
+// One published image and how many passes went into it.
+struct frame_snapshot {
+    std::vector<rgba8> pixels;
+    int samples = 0;
+    int moves = 0;              // camera moves so far
+    float reused = 0;           // share of pixels that kept their samples at the last one
+    bool denoised = false;
+#ifdef RT_STATS
+    thread_counters counters;   // totals up to this snapshot, for the overlay
+    double seconds = 0;
+#endif
+};
+
+// Triple buffer between one producer and one consumer. The producer fills
+// back(), publish() swaps it with the middle slot; the consumer's acquire()
+// swaps the middle slot into front() if it holds something newer. Neither
+// side ever waits for the other and the consumer always sees a whole frame.
+class snapshot_buffer {
+public:
+    snapshot_buffer(int nx, int ny) {
+        for (frame_snapshot &f : frames) f.pixels.assign(size_t(nx) * ny, rgba8{0, 0, 0, 255});
+    }
+
+    frame_snapshot &back() { return frames[back_index]; }
+    const frame_snapshot &front() const { return frames[front_index]; }
+
+    void publish() {
+        int previous = middle.exchange(back_index | fresh_bit, std::memory_order_acq_rel);
+        back_index = previous & index_mask;
+    }
+
+    // true if front() changed
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & fresh_bit)) return false;
+        int previous = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = previous & index_mask;
+        return true;
+    }
+
+private:
+    static const int fresh_bit = 4;
+    static const int index_mask = 3;
+    frame_snapshot frames[3];
+    int back_index = 0;             // producer only
+    int front_index = 1;            // consumer only
+    std::atomic<int> middle{2};     // slot index, plus fresh_bit once published
+};
+
+// Renders passes continuously on its own thread, which drives the tile
+// scheduler as worker 0, and publishes a resolved snapshot after every
+// batch of settings.samples_per_pass samples. The display thread only
+// presents the latest snapshot. Stops taking samples once every pixel has
+// converged (adaptive sampling) and idles until destroyed or moved. With a
+// checkpoint it starts from the checkpoint's snapshot, if there is one,
+// saves between passes when one is due and once more when it stops.
+//
+// move_camera() takes effect between passes: the film is reprojected into
+// the new view (see reprojection.h) and sampling goes on from there. The
+// checkpoint only holds the starting view, so the first move discards it
+// and stops checkpointing.
+//
+// With set_denoise(true) the snapshots are denoised (see denoise.h); the
+// feature buffers are rendered when first needed and again after a move.
+class progressive_renderer {
+public:
+    progressive_renderer(tile_scheduler &pool, hitable *world, const camera &cam, const render_settings &settings,
+                         const resolve_settings &display, int nx, int ny, checkpoint_file *checkpoint = nullptr)
+        : pool(pool), world(world), cam(cam), settings(settings), display(display), image(nx, ny), spare(nx, ny),
+          snapshots(nx, ny), checkpoint(checkpoint), thread(&progressive_renderer::render_loop, this) {}
+
+    ~progressive_renderer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake_cv.notify_all();
+        thread.join();
+    }
+
+    progressive_renderer(const progressive_renderer &) = delete;
+    progressive_renderer &operator=(const progressive_renderer &) = delete;
+
+    // display thread: swaps in the newest snapshot, true if there was one
+    bool acquire() { return snapshots.acquire(); }
+    const frame_snapshot &latest() const { return snapshots.front(); }
+
+    // display thread: denoise the snapshots from the next one on
+    void set_denoise(bool on) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            denoise = on;
+        }
+        wake_cv.notify_all();
+    }
+
+    // display thread: render from c from the next pass on; moves that
+    // arrive during a pass are merged, only the newest one is applied
+    void move_camera(const camera &c) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending_camera = c;
+            camera_moved = true;
+        }
+        wake_cv.notify_all();
+    }
+
+private:
+    tile_scheduler &pool;
+    hitable *world;
+    camera cam;         // render thread only
+    render_settings settings;
+    resolve_settings display;
+    film image;
+    film spare;         // the reprojection target, swapped with image
+    std::vector<float> depth, spare_depth;
+    bool depth_valid = false;
+    reprojection_settings reuse;
+    feature_buffers features;
+    bool features_valid = false;
+    denoiser filter;
+    film denoised{0, 0};
+    std::atomic<bool> denoise{false};
+    snapshot_buffer snapshots;
+    checkpoint_file *checkpoint;
+
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    std::atomic<bool> stopping{false};
+    camera pending_camera = cam;    // guarded by mutex, like camera_moved
+    bool camera_moved = false;
+    std::thread thread;  // last, so everything above exists when it starts
+
+    // true if there was a move to apply
+    bool apply_camera_move(reprojection_stats &stats) {
+        camera next = cam;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!camera_moved) return false;
+            next = pending_camera;
+            camera_moved = false;
+        }
+        if (!depth_valid) primary_depth(pool, world, cam, image.nx, image.ny, depth);
+        stats = reproject(pool, world, image, cam, depth, spare, next, spare_depth, reuse);
+        std::swap(image, spare);
+        std::swap(depth, spare_depth);
+        depth_valid = true;
+        features_valid = false;
+        cam = next;
+        if (checkpoint) {
+            checkpoint->discard();
+            checkpoint = nullptr;
+        }
+        return true;
+    }
+
+    void render_loop() {
+        int passes = 0;
+        int moves = 0;
+        reprojection_stats last_move;
+        double resumed_seconds = 0;
+        auto started = std::chrono::steady_clock::now();
+        auto seconds = [&] {
+            return resumed_seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        };
+        if (checkpoint && checkpoint->restore(image, passes, resumed_seconds)) {
+            fprintf(stderr, "resumed from %s at %d samples\n", checkpoint->file_path().c_str(), passes);
+            resolve(pool, image, snapshots.back().pixels.data(), display);  // shown even if nothing is left to do
+            snapshots.back().samples = passes;
+            snapshots.publish();
+        }
+        RT_STAT(render_stats::reset());
+        RT_STAT(double start = render_stats::now_us());
+        bool shown_denoised = false;
+        auto publish = [&] {
+            frame_snapshot &snapshot = snapshots.back();
+            snapshot.denoised = shown_denoised = denoise;
+            if (snapshot.denoised) {
+                if (!features_valid) render_features(pool, world, cam, image.nx, image.ny, features);
+                features_valid = true;
+                filter.run(pool, image, features, denoised);
+            }
+            resolve(pool, snapshot.denoised ? denoised : image, snapshot.pixels.data(), display);
+            snapshot.samples = passes;
+            snapshot.moves = moves;
+            snapshot.reused = last_move.reused_fraction();
+            RT_STAT(snapshot.counters = render_stats::total());     // the workers are idle here
+            RT_STAT(snapshot.seconds = (render_stats::now_us() - start) * 1e-6);
+            snapshots.publish();
+        };
+        while (!stopping) {
+            if (apply_camera_move(last_move)) {
+                moves++;
+                passes = 0;     // passes since the move
+            }
+            long taken = render_pass(pool, image, world, cam, settings);
+            if (taken == 0) {
+                // converged: idle until there is something to do
+                if (checkpoint) checkpoint->save(image, passes, seconds());
+                std::unique_lock<std::mutex> lock(mutex);
+                wake_cv.wait(lock, [&] { return stopping.load() || camera_moved || denoise != shown_denoised; });
+                lock.unlock();
+                if (denoise != shown_denoised) publish();
+                continue;
+            }
+            passes += settings.samples_per_pass;
+            if (checkpoint && checkpoint->due()) checkpoint->save(image, passes, seconds());
+            publish();
+        }
+        if (checkpoint) checkpoint->save(image, passes, seconds());
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_PROGRESSIVE_H
@@ -0,0 +1,203 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_RENDER_STATS_H
+#define CPU_CPP_RAYTRACING_RENDER_STATS_H
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "material.h"
+
+// Render instrumentation, compiled in with -DRT_STATS (the RT_STATS cmake
+// option). Every thread counts into its own thread_counters, so the hot
+// path only does plain increments on a private cache line; the counters are
+// summed between passes, when the workers are idle. Without RT_STATS the
+// RT_STAT() statements and tile_scope compile to nothing.
+#ifdef RT_STATS
+#define RT_STAT(statement) statement
+#else
+#define RT_STAT(statement)
+#endif
+
+enum prim_type {
+    prim_sphere_packet,     // 8-wide sphere kernel calls
+    prim_triangle_packet,   // 8-wide triangle kernel calls, scene and meshes
+    prim_object,            // hitable::hit on objects outside the packets
+    prim_instance,          // instances entered (each then tests its mesh's packets)
+    prim_type_count
+};
+
+const char *const prim_type_names[prim_type_count] = {"sphere_packet", "triangle_packet", "object", "instance"};
+
+const int path_length_buckets = 64;     // the last one holds everything longer
+
+struct alignas(64) thread_counters {
+    uint64_t camera_rays = 0;
+    uint64_t rays = 0;                      // all world->hit calls, camera rays included
+    uint64_t shadow_rays = 0;               // of those, the ones towards sampled lights
+    uint64_t prim_tests[prim_type_count] = {};
+    uint64_t scatter_calls[material_type_count] = {};
+    uint64_t path_length[path_length_buckets] = {};     // rays per path
+
+    void add_path(int length) {
+        path_length[length < path_length_buckets ? length : path_length_buckets - 1]++;
+    }
+
+    void merge(const thread_counters &o) {
+        camera_rays += o.camera_rays;
+        rays += o.rays;
+        shadow_rays += o.shadow_rays;
+        for (int k = 0; k < prim_type_count; k++) prim_tests[k] += o.prim_tests[k];
+        for (int k = 0; k < material_type_count; k++) scatter_calls[k] += o.scatter_calls[k];
+        for (int k = 0; k < path_length_buckets; k++) path_length[k] += o.path_length[k];
+    }
+
+    double mean_path_length() const {
+        uint64_t paths = 0, total = 0;
+        for (int k = 0; k < path_length_buckets; k++) {
+            paths += path_length[k];
+            total += path_length[k] * k;
+        }
+        return paths ? double(total) / paths : 0.0;
+    }
+};
+
+// one tile of one pass, for the chrome trace
+struct tile_event {
+    int tile, worker, pass;
+    double start_us, duration_us;
+};
+
+class render_stats {
+public:
+    static thread_counters &local() { return local_data().counters; }
+
+    // only while no pass is running
+    static thread_counters total() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        thread_counters sum;
+        for (auto &d : registry) sum.merge(d->counters);
+        return sum;
+    }
+
+    static void reset() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto &d : registry) {
+            d->counters = thread_counters();
+            d->tiles.clear();
+        }
+        pass = 0;
+    }
+
+    static void begin_pass() { pass++; }
+
+    static double now_us() {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // wall time of one tile on one worker
+    class tile_scope {
+    public:
+#ifdef RT_STATS
+        tile_scope(int tile, int worker) : tile(tile), worker(worker), start(now_us()) {}
+        ~tile_scope() {
+            std::vector<tile_event> &tiles = local_data().tiles;
+            if (tiles.size() < max_tile_events) tiles.push_back({tile, worker, pass, start, now_us() - start});
+        }
+    private:
+        int tile, worker;
+        double start;
+#else
+        tile_scope(int, int) {}
+#endif
+    };
+
+    static bool write_json(const std::string &path, double seconds) {
+        FILE *f = fopen(path.c_str(), "w");
+        if (!f) return false;
+        thread_counters t = total();
+        fprintf(f, "{\n  \"seconds\": %.6f,\n  \"passes\": %d,\n  \"camera_rays\": %llu,\n  \"rays\": %llu,\n",
+                seconds, pass.load(), (unsigned long long)t.camera_rays, (unsigned long long)t.rays);
+        fprintf(f, "  \"shadow_rays\": %llu,\n", (unsigned long long)t.shadow_rays);
+        fprintf(f, "  \"rays_per_second\": %.1f,\n  \"mean_path_length\": %.4f,\n  \"prim_tests\": {",
+                seconds > 0 ? t.rays / seconds : 0.0, t.mean_path_length());
+        for (int k = 0; k < prim_type_count; k++) {
+            fprintf(f, "%s\"%s\": %llu", k ? ", " : "", prim_type_names[k], (unsigned long long)t.prim_tests[k]);
+        }
+        fprintf(f, "},\n  \"scatter_calls\": {");
+        for (int k = 0; k < material_type_count; k++) {
+            fprintf(f, "%s\"%s\": %llu", k ? ", " : "", material_type_names[k], (unsigned long long)t.scatter_calls[k]);
+        }
+        fprintf(f, "},\n  \"path_length\": [");
+        for (int k = 0; k < path_length_buckets; k++) {
+            fprintf(f, "%s%llu", k ? ", " : "", (unsigned long long)t.path_length[k]);
+        }
+        fprintf(f, "],\n  \"tiles\": {");
+        size_t tiles = 0;
+        double busy_us = 0, longest_us = 0;
+        for_each_tile([&](const tile_event &e) {
+            tiles++;
+            busy_us += e.duration_us;
+            longest_us = std::max(longest_us, e.duration_us);
+        });
+        fprintf(f, "\"count\": %zu, \"mean_us\": %.2f, \"max_us\": %.2f}\n}\n", tiles, tiles ? busy_us / tiles : 0.0,
+                longest_us);
+        return fclose(f) == 0;
+    }
+
+    // chrome://tracing / Perfetto "complete" events, one row per worker
+    static bool write_trace(const std::string &path) {
+        FILE *f = fopen(path.c_str(), "w");
+        if (!f) return false;
+        fprintf(f, "{\"traceEvents\": [");
+        bool first = true;
+        for_each_tile([&](const tile_event &e) {
+            fprintf(f, "%s\n{\"name\": \"tile %d\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                       "\"args\": {\"pass\": %d}}",
+                    first ? "" : ",", e.tile, e.worker, e.start_us, e.duration_us, e.pass);
+            first = false;
+        });
+        fprintf(f, "\n], \"displayTimeUnit\": \"ms\"}\n");
+        return fclose(f) == 0;
+    }
+
+private:
+    struct thread_data {
+        thread_counters counters;
+        std::vector<tile_event> tiles;
+    };
+
+    static const size_t max_tile_events = 1 << 20;     // per thread, about 24 MB
+    static inline std::mutex registry_mutex;
+    static inline std::vector<std::unique_ptr<thread_data>> registry;   // outlives the threads
+    static inline std::atomic<int> pass{0};
+    static inline const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    static thread_data *register_thread() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(std::make_unique<thread_data>());
+        return registry.back().get();
+    }
+
+    static thread_data &local_data() {
+        thread_local thread_data *data = register_thread();
+        return *data;
+    }
+
+    template <class fn>
+    static void for_each_tile(fn &&f) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto &d : registry) {
+            for (const tile_event &e : d->tiles) f(e);
+        }
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_RENDER_STATS_H
@@ -0,0 +1,111 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_RENDERER_H
+#define CPU_CPP_RAYTRACING_RENDERER_H
+#include <atomic>
+#include <vector>
+
+#include "camera.h"
+#include "film.h"
+#include "hitable.h"
+#include "integrator.h"
+#include "material.h"
+#include "ray.h"
+#include "render_stats.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "wavefront.h"
+
+// tiles are small enough that the expensive ones (the glass cube) get spread
+// over all workers instead of landing in one thread's band
+const int tile_size = 16;
+
+// the image cut into tile_size squares, numbered row by row
+struct tile_grid {
+    int nx, ny;
+    int tiles_x, tiles_y;
+
+    tile_grid(int nx, int ny)
+        : nx(nx), ny(ny), tiles_x((nx + tile_size - 1) / tile_size), tiles_y((ny + tile_size - 1) / tile_size) {}
+
+    int count() const { return tiles_x * tiles_y; }
+
+    void bounds(int tile, int& start_x, int& end_x, int& start_y, int& end_y) const {
+        start_x = (tile % tiles_x) * tile_size;
+        start_y = (tile / tiles_x) * tile_size;
+        end_x = std::min(start_x + tile_size, nx);
+        end_y = std::min(start_y + tile_size, ny);
+    }
+};
+
+// Adds one sample to every pixel of the tile that has not converged and
+// returns how many were taken. Display conversion is left to resolve().
+int render_tile(film& image, hitable* world, camera& cam,
+                int start_x, int end_x, int start_y, int end_y, const render_settings& settings) {
+    int nx = image.nx, ny = image.ny;
+    int taken = 0;
+    sampler s(settings.seed, settings.sampling, settings.sample_count);
+    float spread = cam.pixel_spread(ny);
+    for (int j = start_y; j < end_y; j++) {
+        for (int i = start_x; i < end_x; i++) {
+            int idx = (ny - 1 - j) * nx + i;
+            if (image.converged[idx]) continue;
+            s.start_pixel_sample(i, j, image.sample_index(idx));
+
+            point2 jitter = s.next_2d();
+            float u = float(i + jitter.x) / float(nx);
+            float v = float(j + jitter.y) / float(ny);
+            ray r = cam.get_ray(u, v);
+            RT_STAT(render_stats::local().camera_rays++);
+            image.add(idx, color(r, world, settings.bounces, s, ray_cone{0, spread}));
+            taken++;
+        }
+    }
+    return taken;
+}
+
+// render_tile with the integrator settings ask for
+int trace_tile(film& image, hitable* world, camera& cam,
+               int start_x, int end_x, int start_y, int end_y, const render_settings& settings) {
+    if (settings.integrator == integrator_wavefront) {
+        return render_tile_wavefront(image, world, cam, start_x, end_x, start_y, end_y, settings);
+    }
+    return render_tile(image, world, cam, start_x, end_x, start_y, end_y, settings);
+}
+
+// settings.samples_per_pass samples for every pixel still sampling, then (with a noise threshold)
+// the convergence test, as a second sweep since it reads the neighbours.
+// Returns the number of samples taken, 0 once every pixel has converged.
+long render_pass(tile_scheduler& pool, film& image, hitable* world, camera& cam,
+                 const render_settings& settings) {
+    int ny = image.ny;
+    tile_grid grid(image.nx, ny);
+
+    std::atomic<long> taken{0};
+    RT_STAT(render_stats::begin_pass());
+    pool.run(grid.count(), [&](int tile, int worker) {
+        render_stats::tile_scope timer(tile, worker);
+        int start_x, end_x, start_y, end_y;
+        grid.bounds(tile, start_x, end_x, start_y, end_y);
+        for (int s = 0; s < settings.samples_per_pass; s++) {
+            taken += trace_tile(image, world, cam, start_x, end_x, start_y, end_y, settings);
+        }
+    });
+
+    if (settings.noise_threshold > 0 && taken > 0) {
+        pool.run(grid.count(), [&](int tile, int) {
+            int start_x, end_x, start_y, end_y;
+            grid.bounds(tile, start_x, end_x, start_y, end_y);
+            for (int j = start_y; j < end_y; j++) {
+                for (int i = start_x; i < end_x; i++) {
+                    image.update_converged(i, ny - 1 - j, settings.noise_threshold, settings.min_samples);
+                }
+            }
+        });
+    }
+    return taken;
+}
+
+#endif //CPU_CPP_RAYTRACING_RENDERER_H
@@ -0,0 +1,129 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_REPROJECTION_H
+#define CPU_CPP_RAYTRACING_REPROJECTION_H
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "camera.h"
+#include "film.h"
+#include "hitable.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+// Reuse of accumulated samples when the camera moves. Every pixel keeps
+// the distance to what its center ray hits first (INFINITY for the sky).
+// For the new view, each pixel's center ray finds its first hit, which is
+// projected into the old view; if the old pixel there saw the same surface
+// (its distance agrees) the pixel takes over the old pixel's sums,
+// otherwise it was disoccluded and starts from zero. Sky pixels match by
+// direction, so turning around reuses the sky as well.
+//
+// Radiance is view dependent (highlights, glass), so the reused history is
+// capped at history_limit samples: new samples outweigh it soon and stale
+// reflections fade while the image stays usable during a move. A reused
+// pixel's sample indices go on after the old pixel's, so the sampler never
+// hands it a point that is already in its history.
+
+struct reprojection_settings {
+    int history_limit = 32;         // samples a reused pixel keeps at most
+    float depth_tolerance = 0.03f;  // relative distance difference that still counts as the same surface
+};
+
+struct reprojection_stats {
+    long reused = 0;
+    long reset = 0;
+
+    float reused_fraction() const { return reused + reset ? float(reused) / float(reused + reset) : 0.0f; }
+};
+
+// distance to the first hit along every pixel's center ray, indexed like the film
+void primary_depth(tile_scheduler &pool, hitable *world, camera &cam, int nx, int ny, std::vector<float> &depth) {
+    depth.resize(size_t(nx) * ny);
+    tile_grid grid(nx, ny);
+    pool.run(grid.count(), [&](int tile, int) {
+        int start_x, end_x, start_y, end_y;
+        grid.bounds(tile, start_x, end_x, start_y, end_y);
+        for (int j = start_y; j < end_y; j++) {
+            for (int i = start_x; i < end_x; i++) {
+                ray r = cam.get_ray((i + 0.5f) / nx, (j + 0.5f) / ny);
+                hit_record rec;
+                bool hit = world->hit(r, 0.001, INFINITY, rec);
+                depth[(ny - 1 - j) * nx + i] = hit ? rec.t * r.direction().length() : INFINITY;
+            }
+        }
+    });
+}
+
+// Fills to (and to_depth) for the view to_cam from from, rendered from
+// from_cam with from_depth. to must have from's size; it is overwritten.
+reprojection_stats reproject(tile_scheduler &pool, hitable *world, const film &from, camera &from_cam,
+                             const std::vector<float> &from_depth, film &to, camera &to_cam,
+                             std::vector<float> &to_depth, const reprojection_settings &settings) {
+    int nx = from.nx, ny = from.ny;
+    primary_depth(pool, world, to_cam, nx, ny, to_depth);
+
+    tile_grid grid(nx, ny);
+    std::atomic<long> reused{0};
+    pool.run(grid.count(), [&](int tile, int) {
+        int start_x, end_x, start_y, end_y;
+        grid.bounds(tile, start_x, end_x, start_y, end_y);
+        long tile_reused = 0;
+        for (int j = start_y; j < end_y; j++) {
+            for (int i = start_x; i < end_x; i++) {
+                int idx = (ny - 1 - j) * nx + i;
+                to.sum[idx] = vec3(0, 0, 0);
+                to.lum_sq[idx] = 0;
+                to.samples[idx] = 0;
+                to.first_index[idx] = 0;
+                to.errors[idx] = INFINITY;
+                to.converged[idx] = 0;
+
+                vec3 direction = to_cam.get_ray((i + 0.5f) / nx, (j + 0.5f) / ny).direction();
+                float distance = to_depth[idx];
+                float s, t;
+                bool visible;
+                vec3 point;
+                if (std::isinf(distance)) {
+                    visible = from_cam.project_direction(direction, s, t);
+                } else {
+                    point = to_cam.origin + unit_vector(direction) * distance;
+                    visible = from_cam.project(point, s, t);
+                }
+                if (!visible || s < 0 || s >= 1 || t < 0 || t >= 1) continue;
+                int from_i = std::min(int(s * nx), nx - 1);
+                int from_j = std::min(int(t * ny), ny - 1);
+                int from_idx = (ny - 1 - from_j) * nx + from_i;
+                float seen = from_depth[from_idx];
+                if (std::isinf(distance) != std::isinf(seen)) continue;
+                if (!std::isinf(distance)) {
+                    float expected = (point - from_cam.origin).length();
+                    if (std::fabs(seen - expected) > settings.depth_tolerance * expected) continue;
+                }
+
+                int n = from.samples[from_idx];
+                if (n == 0) continue;
+                float keep = n > settings.history_limit ? float(settings.history_limit) / n : 1.0f;
+                to.sum[idx] = from.sum[from_idx] * keep;
+                to.lum_sq[idx] = from.lum_sq[from_idx] * keep;
+                to.samples[idx] = std::min(n, settings.history_limit);
+                // the next sample follows the ones in the history, not one of them again
+                to.first_index[idx] = from.first_index[from_idx] + n - to.samples[idx];
+                to.errors[idx] = to.error(idx);
+                tile_reused++;
+            }
+        }
+        reused += tile_reused;
+    });
+
+    reprojection_stats stats;
+    stats.reused = reused;
+    stats.reset = long(nx) * ny - stats.reused;
+    return stats;
+}
+
+#endif //CPU_CPP_RAYTRACING_REPROJECTION_H
@@ -0,0 +1,243 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_RESOLVE_H
+#define CPU_CPP_RAYTRACING_RESOLVE_H
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "film.h"
+#include "image_io.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+enum tonemap_op {
+    tonemap_clamp,      // plain clip at 1, what the renderer always did
+    tonemap_reinhard,   // x / (1 + x) per channel
+    tonemap_aces,       // Narkowicz's fit of the ACES filmic curve
+};
+
+// film -> display conversion, applied only when an image is shown or saved
+struct resolve_settings {
+    float exposure = 0;     // in stops
+    tonemap_op tonemap = tonemap_clamp;
+    float gamma = 2;
+
+    float scale() const { return std::exp2(exposure); }
+};
+
+// returns false for an unknown name
+bool parse_tonemap(const char *name, tonemap_op &op) {
+    if (!strcmp(name, "clamp")) op = tonemap_clamp;
+    else if (!strcmp(name, "reinhard")) op = tonemap_reinhard;
+    else if (!strcmp(name, "aces")) op = tonemap_aces;
+    else return false;
+    return true;
+}
+
+// Converts count pixels of accumulated radiance: mean, exposure, tone
+// curve, gamma, 8 bit. The SIMD versions handle gamma 2 with a square root
+// like the scalar one and other gammas with a polynomial exp2/log2 that can
+// differ from std::pow by one 8-bit step.
+typedef void (*resolve_kernel)(const vec3 *sum, const int *samples, int count, const resolve_settings &settings,
+                               rgba8 *out);
+
+inline float tonemap_scalar(float x, tonemap_op op) {
+    if (op == tonemap_reinhard) return x / (1 + x);
+    if (op == tonemap_aces) return x * (2.51f * x + 0.03f) / (x * (2.43f * x + 0.59f) + 0.14f);
+    return x;
+}
+
+void resolve_scalar(const vec3 *sum, const int *samples, int count, const resolve_settings &settings, rgba8 *out) {
+    float scale = settings.scale();
+    float inv_gamma = 1 / settings.gamma;
+    for (int i = 0; i < count; i++) {
+        float weight = samples[i] ? scale / float(samples[i]) : 0.0f;
+        unsigned char c[3];
+        for (int k = 0; k < 3; k++) {
+            float x = std::clamp(tonemap_scalar(sum[i][k] * weight, settings.tonemap), 0.0f, 1.0f);
+            x = settings.gamma == 2 ? std::sqrt(x) : std::pow(x, inv_gamma);
+            c[k] = (unsigned char)std::min(x * 255.99f, 255.0f);
+        }
+        out[i] = {c[0], c[1], c[2], 255};
+    }
+}
+
+#ifdef RT_SIMD_X86
+// the 8-bit result only needs about 1e-4 relative accuracy
+inline __m128 log2_sse(__m128 x) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128 m = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff))), _mm_set1_ps(1.0f));
+    // log2(m) on [1, 2), least squares polynomial in (m - 1)
+    __m128 t = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+    __m128 p = _mm_set1_ps(0.0458872202f);
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.194426369f));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.415424722f));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.708682923f));
+    p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.44182587f));
+    p = _mm_mul_ps(p, t);
+    return _mm_add_ps(e, p);
+}
+
+inline __m128 exp2_sse(__m128 x) {
+    x = _mm_max_ps(x, _mm_set1_ps(-126.0f));
+    __m128 fl = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    fl = _mm_sub_ps(fl, _mm_and_ps(_mm_cmplt_ps(x, fl), _mm_set1_ps(1.0f)));  // floor for negatives
+    __m128 f = _mm_sub_ps(x, fl);
+    __m128 p = _mm_set1_ps(0.0135557f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0520323f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.2413797f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.6930321f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fl), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(p, _mm_castsi128_ps(e));
+}
+
+inline __m128 tonemap_sse(__m128 x, tonemap_op op) {
+    if (op == tonemap_reinhard) return _mm_div_ps(x, _mm_add_ps(x, _mm_set1_ps(1.0f)));
+    if (op == tonemap_aces) {
+        __m128 num = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+        __m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))),
+                                _mm_set1_ps(0.14f));
+        return _mm_div_ps(num, den);
+    }
+    return x;
+}
+
+void resolve_sse(const vec3 *sum, const int *samples, int count, const resolve_settings &settings, rgba8 *out) {
+    __m128 scale = _mm_set1_ps(settings.scale());
+    __m128 inv_gamma = _mm_set1_ps(1 / settings.gamma);
+    bool square_root = settings.gamma == 2;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // film pixels are xyz triples; transpose through the stack
+        alignas(16) float c[3][4];
+        for (int lane = 0; lane < 4; lane++) {
+            for (int k = 0; k < 3; k++) c[k][lane] = sum[i + lane][k];
+        }
+        __m128 n = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(samples + i)));
+        __m128 weight = _mm_and_ps(_mm_div_ps(scale, n), _mm_cmpgt_ps(n, _mm_setzero_ps()));
+        alignas(16) int32_t bytes[3][4];
+        for (int k = 0; k < 3; k++) {
+            __m128 x = tonemap_sse(_mm_mul_ps(_mm_load_ps(c[k]), weight), settings.tonemap);
+            x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            x = square_root ? _mm_sqrt_ps(x) : _mm_and_ps(exp2_sse(_mm_mul_ps(log2_sse(x), inv_gamma)),
+                                                          _mm_cmpgt_ps(x, _mm_setzero_ps()));
+            x = _mm_min_ps(_mm_mul_ps(x, _mm_set1_ps(255.99f)), _mm_set1_ps(255.0f));
+            _mm_store_si128((__m128i *)bytes[k], _mm_cvttps_epi32(x));
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            out[i + lane] = {(unsigned char)bytes[0][lane], (unsigned char)bytes[1][lane],
+                             (unsigned char)bytes[2][lane], 255};
+        }
+    }
+    resolve_scalar(sum + i, samples + i, count - i, settings, out + i);
+}
+#endif
+
+#ifdef RT_SIMD_AVX2
+RT_TARGET_AVX2 inline __m256 log2_avx(__m256 x) {
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+    __m256 m = _mm256_or_ps(_mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff))),
+                            _mm256_set1_ps(1.0f));
+    __m256 t = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+    __m256 p = _mm256_set1_ps(0.0458872202f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(-0.194426369f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(0.415424722f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(-0.708682923f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(1.44182587f));
+    p = _mm256_mul_ps(p, t);
+    return _mm256_add_ps(e, p);
+}
+
+RT_TARGET_AVX2 inline __m256 exp2_avx(__m256 x) {
+    x = _mm256_max_ps(x, _mm256_set1_ps(-126.0f));
+    __m256 fl = _mm256_floor_ps(x);
+    __m256 f = _mm256_sub_ps(x, fl);
+    __m256 p = _mm256_set1_ps(0.0135557f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.0520323f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.2413797f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.6930321f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fl), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+
+RT_TARGET_AVX2 inline __m256 tonemap_avx(__m256 x, tonemap_op op) {
+    if (op == tonemap_reinhard) return _mm256_div_ps(x, _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+    if (op == tonemap_aces) {
+        __m256 num = _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.51f)), _mm256_set1_ps(0.03f)));
+        __m256 den = _mm256_add_ps(
+            _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.43f)), _mm256_set1_ps(0.59f))),
+            _mm256_set1_ps(0.14f));
+        return _mm256_div_ps(num, den);
+    }
+    return x;
+}
+
+RT_TARGET_AVX2
+void resolve_avx2(const vec3 *sum, const int *samples, int count, const resolve_settings &settings, rgba8 *out) {
+    __m256 scale = _mm256_set1_ps(settings.scale());
+    __m256 inv_gamma = _mm256_set1_ps(1 / settings.gamma);
+    bool square_root = settings.gamma == 2;
+    // gathers one channel of 8 consecutive xyz triples
+    const __m256i channel_index = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const float *base = sum[i].e;
+        __m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(samples + i)));
+        __m256 weight = _mm256_and_ps(_mm256_div_ps(scale, n), _mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_GT_OQ));
+        __m256i bytes = _mm256_set1_epi32(int(0xff000000));  // alpha
+        for (int k = 0; k < 3; k++) {
+            __m256 x = _mm256_i32gather_ps(base + k, channel_index, 4);
+            x = tonemap_avx(_mm256_mul_ps(x, weight), settings.tonemap);
+            x = _mm256_min_ps(_mm256_max_ps(x, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+            x = square_root ? _mm256_sqrt_ps(x)
+                            : _mm256_and_ps(exp2_avx(_mm256_mul_ps(log2_avx(x), inv_gamma)),
+                                            _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ));
+            x = _mm256_min_ps(_mm256_mul_ps(x, _mm256_set1_ps(255.99f)), _mm256_set1_ps(255.0f));
+            bytes = _mm256_or_si256(bytes, _mm256_slli_epi32(_mm256_cvttps_epi32(x), 8 * k));
+        }
+        _mm256_storeu_si256((__m256i *)(out + i), bytes);  // r, g, b, a bytes in little endian order
+    }
+    resolve_scalar(sum + i, samples + i, count - i, settings, out + i);
+}
+#endif
+
+resolve_kernel resolve_kernel_for(simd_level level) {
+    switch (level) {
+#ifdef RT_SIMD_AVX2
+        case simd_avx2: return resolve_avx2;
+#endif
+#ifdef RT_SIMD_X86
+        case simd_sse: return resolve_sse;
+#endif
+        default: return resolve_scalar;
+    }
+}
+
+// Film -> 8-bit display pixels, row by row on the tile scheduler, with the
+// kernel matching the selected --simd level.
+void resolve(tile_scheduler &pool, const film &image, rgba8 *pixels, const resolve_settings &settings) {
+    resolve_kernel kernel = resolve_kernel_for(simd.level);
+    int nx = image.nx;
+    pool.run(image.ny, [&](int row, int) {
+        size_t first = size_t(row) * nx;
+        kernel(&image.sum[first], &image.samples[first], nx, settings, pixels + first);
+    });
+}
+
+// film -> linear radiance with the exposure applied, for the HDR formats
+std::vector<vec3> resolve_linear(const film &image, const resolve_settings &settings) {
+    std::vector<vec3> linear(image.sum.size());
+    float scale = settings.scale();
+    for (size_t i = 0; i < linear.size(); i++) linear[i] = image.mean(int(i)) * scale;
+    return linear;
+}
+
+#endif //CPU_CPP_RAYTRACING_RESOLVE_H
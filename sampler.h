@@ -0,0 +1,265 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_SAMPLER_H
+#define CPU_CPP_RAYTRACING_SAMPLER_H
+#include <algorithm>
+#include <cstdint>
+
+#include "blue_noise.h"
+
+struct point2 {
+    float x, y;
+};
+
+// 64 bit finalizer (splitmix64), used to turn (seed, pixel, sample) into a stream start
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// 32 bit integer hash (lowbias32), for the per dimension seeds
+inline uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// PCG32 (XSH-RR): 16 bytes of state, a few integer ops per number
+struct pcg32 {
+    uint64_t state = 0x853c49e6748fea9bull;
+    uint64_t inc = 0xda3e39cb94b95bdbull;
+
+    void seed(uint64_t init_state, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        next_uint();
+        state += init_state;
+        next_uint();
+    }
+
+    inline uint32_t next_uint() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + inc;
+        uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+        uint32_t rot = uint32_t(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // uniform in [0, 1)
+    inline float next_float() {
+        return float(next_uint() >> 8) * 0x1p-24f;
+    }
+};
+
+inline uint32_t reverse_bits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Laine and Karras' hash: a random flip of every bit that depends only on
+// the bits below it
+inline uint32_t laine_karras(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Owen scrambling, hashed (Burley 2020, "Practical Hash-based Owen
+// Scrambling"): every bit flipped depending only on the bits above it, so
+// scrambled points keep the stratification of the originals
+inline uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+    return reverse_bits(laine_karras(reverse_bits(x), seed));
+}
+
+// The second dimension of the Sobol sequence (the first is reverse_bits),
+// bit reversed. Its direction numbers, from the polynomial x + 1, are the
+// rows of Pascal's triangle mod 2, and multiplying by that matrix goes by
+// halves: within every block of 2s bits, the upper half is xored into the
+// lower one.
+inline uint32_t sobol_second_reversed(uint32_t index) {
+    index ^= (index & 0xaaaaaaaau) >> 1;
+    index ^= (index & 0xccccccccu) >> 2;
+    index ^= (index & 0xf0f0f0f0u) >> 4;
+    index ^= (index & 0xff00ff00u) >> 8;
+    index ^= (index & 0xffff0000u) >> 16;
+    return index;
+}
+
+// Kensler's hashed permutation of 0..n-1 ("Correlated Multi-Jittered
+// Sampling"): element i of the permutation picked by seed
+inline uint32_t permutation_element(uint32_t i, uint32_t n, uint32_t seed) {
+    uint32_t w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= seed;
+        i *= 0xe170893du;
+        i ^= seed >> 16;
+        i ^= (i & w) >> 4;
+        i ^= seed >> 8;
+        i *= 0x0929eb3fu;
+        i ^= seed >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | seed >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + seed) % n;
+}
+
+// where the numbers of a sampler come from
+enum sampler_type {
+    sampler_independent,    // pcg32, each number on its own
+    sampler_stratified,     // per dimension, one jittered stratum of sample_count per sample
+    sampler_sobol,          // Owen-scrambled Sobol pairs, scrambled anew per pixel and dimension
+    sampler_blue_noise,     // one scrambled Sobol sequence for all pixels, shifted per pixel by blue noise
+    sampler_type_count
+};
+
+// for command line settings
+const char *const sampler_type_names[sampler_type_count] = {"independent", "stratified", "sobol", "blue-noise"};
+
+// Random numbers for one path. Each render thread owns one and restarts it for
+// every pixel sample, so nothing is shared between threads and a render only
+// depends on the seed, never on which thread took which tile.
+//
+// A number is a function of (pixel, sample index, dimension): the path
+// draws its dimensions in order with next_1d() and next_2d() (a pair is one
+// dimension of 2D points), and sample i of a pixel gets point i of that
+// pixel's sequence in every dimension. The low-discrepancy types spread the
+// first N samples of a pixel evenly over each dimension (Sobol in 2D pairs,
+// stratification for sample_count samples), which lowers the error for the
+// same sample count; the pairs are padded, each dimension scrambled on its
+// own, so any number of bounces works. Blue noise shares the sequence
+// between pixels and shifts it by a blue noise tile, which makes the error
+// of neighboring pixels differ as much as possible: at low sample counts
+// the noise is fine grained, and easy on the eye and on the denoiser.
+class sampler {
+public:
+    explicit sampler(uint64_t seed = 0, sampler_type type = sampler_independent, uint32_t sample_count = 64)
+        : seed(seed), type(type), sample_count(sample_count < 1 ? 1 : sample_count) {
+        grid = 1;
+        while (grid * grid < this->sample_count) grid++;
+        if (type == sampler_blue_noise) tile = &blue_noise();
+    }
+
+    // pixel (x, y) of the image, sample_index counting from 0 in that pixel
+    void start_pixel_sample(uint32_t x, uint32_t y, uint32_t sample_index) {
+        uint64_t pixel = mix64(((uint64_t(y) << 32) | x) ^ mix64(seed));
+        rng.seed(mix64(pixel + sample_index), mix64(seed + 1));
+        pixel_x = x;
+        pixel_y = y;
+        this->sample_index = sample_index;
+        // blue noise scrambles the same way in every pixel
+        pixel_seed = uint32_t(type == sampler_blue_noise ? mix64(seed) : pixel);
+        dimension = 0;
+    }
+
+    inline float next_1d() {
+        if (type == sampler_independent) return rng.next_float();
+        if (type == sampler_stratified) return stratified_1d();
+        return to_float(sobol_1d());
+    }
+
+    inline point2 next_2d() {
+        if (type == sampler_independent) {
+            float x = rng.next_float();
+            return {x, rng.next_float()};
+        }
+        if (type == sampler_stratified) return stratified_2d();
+        uint32_t x, y;
+        sobol_2d(x, y);
+        return {to_float(x), to_float(y)};
+    }
+
+    uint64_t seed;
+    sampler_type type;
+    uint32_t sample_count;      // what stratified lays its strata out for
+    pcg32 rng;
+
+private:
+    uint32_t grid;              // stratified 2D: grid x grid cells
+    const blue_noise_tile *tile = nullptr;
+    uint32_t pixel_x = 0, pixel_y = 0;
+    uint32_t sample_index = 0;
+    uint32_t pixel_seed = 0;
+    uint32_t dimension = 0;
+
+    static float to_float(uint32_t x) { return float(x >> 8) * 0x1p-24f; }
+
+    // (cell + jitter) / cells, kept below 1
+    float jittered(uint32_t cell, uint32_t cells) {
+        return std::min((float(cell) + rng.next_float()) / float(cells), 0x1.fffffep-1f);
+    }
+
+    uint32_t dimension_seed() { return mix32(pixel_seed ^ mix32(dimension++ * 0x9e3779b9u + 1)); }
+
+    // Every sample_count samples visit the strata of a dimension once, in
+    // an order shuffled per pixel, dimension and round.
+    float stratified_1d() {
+        uint32_t s = dimension_seed(), n = sample_count;
+        return jittered(permutation_element(sample_index % n, n, mix32(s ^ (sample_index / n))), n);
+    }
+
+    point2 stratified_2d() {
+        uint32_t s = dimension_seed(), cells = grid * grid;
+        uint32_t cell = permutation_element(sample_index % cells, cells, mix32(s ^ (sample_index / cells)));
+        float x = jittered(cell % grid, grid);
+        return {x, jittered(cell / grid, grid)};
+    }
+
+    // a toroidal shift by the blue noise tile, read at an offset of its own per coordinate
+    uint32_t shift(uint32_t x, uint32_t offset) const {
+        uint32_t rank = tile->at(int(pixel_x + (offset & 63)), int(pixel_y + (offset >> 6 & 63)));
+        return x + (rank << 20) + (1u << 19);
+    }
+
+    // The index is shuffled by an Owen scramble of its own, then the point
+    // scrambled: owen_scramble(reverse_bits(index)) is reverse_bits of the
+    // hash of index, likewise for the second dimension.
+    uint32_t sobol_1d() {
+        uint32_t s = dimension_seed();
+        uint32_t x = reverse_bits(laine_karras(owen_scramble(sample_index, s), mix32(s + 1)));
+        return type == sampler_blue_noise ? shift(x, s >> 12) : x;
+    }
+
+    // both coordinates from the same shuffled index keep the pair a (0, 2)-sequence
+    void sobol_2d(uint32_t &x, uint32_t &y) {
+        uint32_t s = dimension_seed();
+        uint32_t index = owen_scramble(sample_index, s);
+        x = reverse_bits(laine_karras(index, mix32(s + 1)));
+        y = reverse_bits(laine_karras(sobol_second_reversed(index), mix32(s + 2)));
+        if (type == sampler_blue_noise) {
+            x = shift(x, s >> 12);
+            y = shift(y, s >> 20);
+        }
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_SAMPLER_H
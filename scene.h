@@ -0,0 +1,544 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_SCENE_H
+#define CPU_CPP_RAYTRACING_SCENE_H
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <vector>
+#include "arena.h"
+#include "bvh.h"
+#include "cube.h"
+#include "hitable.h"
+#include "instance.h"
+#include "light.h"
+#include "mapped_file.h"
+#include "material.h"
+#include "render_stats.h"
+#include "simd.h"
+#include "triangle_mesh.h"
+
+// Data-oriented world. Primitives are grouped by type into SIMD packets
+// (spheres together, triangles together) with one BVH per type whose leaves
+// are single packets, and refer to materials by id. hit() runs one
+// non-virtual loop per type; only extra objects such as meshes still go
+// through hitable::hit, once per object rather than per primitive.
+//
+// Repeated geometry is instanced in two levels: shared meshes (the bottom
+// level, each a packet BVH in its own space) and instances placing them with
+// a transform and a material, under a BVH of their own (the top level). A
+// ray reaching an instance is moved into the mesh's space rather than the
+// mesh into the world, so a thousand copies cost a thousand transforms, not
+// a thousand meshes. Cubes are instances of one shared unit cube.
+//
+// The spheres and triangles, instanced or not, that have a diffuse_light are
+// also gathered into a light list for the integrators to sample (light.h).
+//
+// Fill it with add_*() and call build() once before tracing, or point it at
+// the arrays of a compiled scene file with use_compiled() (see scene_file.h).
+// Materials and objects made with make_*() live in the scene's arena and go
+// away with it; clear() empties the scene for the next one, reusing the
+// arena's memory.
+class scene : public hitable {
+public:
+    // What traversal reads: the packet arrays below after build(), or the
+    // same arrays inside a mapped file.
+    template <class packet_t>
+    struct packet_view {
+        std::span<const bvh_node> nodes;            // empty for an unsorted list
+        std::span<const packet_t> packets;
+        std::span<const uint32_t> material_ids;     // per packet lane
+    };
+
+    std::vector<material*> materials;           // indexed by material id
+    static const uint32_t no_material = 0xffffffff;    // the id of an empty packet lane
+
+    std::vector<sphere_packet> sphere_packets;
+    std::vector<uint32_t> sphere_material;      // per packet lane
+    bvh_tree sphere_bvh;
+
+    std::vector<triangle_packet> triangle_packets;
+    std::vector<uint32_t> triangle_material;    // per packet lane
+    bvh_tree triangle_bvh;
+
+    // what instance traversal reads, like packet_view
+    struct instance_view {
+        std::span<const bvh_node> nodes;            // empty for an unsorted list
+        std::span<const mesh_instance> instances;
+    };
+
+    // the packets of a mesh and its BVH, whose leaf offsets index them
+    struct shared_mesh {
+        bvh_tree tree;
+        std::vector<triangle_packet> packets;
+    };
+
+    std::vector<shared_mesh> meshes;            // indexed by mesh id
+    std::vector<mesh_instance> instances;       // in leaf order after build()
+    bvh_tree instance_bvh;
+
+    std::vector<hitable*> objects;              // everything that is not a sphere or a triangle
+    std::unique_ptr<bvh> object_bvh;
+
+    packet_view<sphere_packet> sphere_view;
+    packet_view<triangle_packet> triangle_view;
+    std::vector<packet_view<triangle_packet>> bottom_level;     // per mesh; no material ids
+    instance_view top_level;
+
+    light_list emitters;                        // the primitives with a diffuse_light, from the views
+
+    // the caller keeps m alive for as long as the scene
+    int add_material(material *m) {
+        materials.push_back(m);
+        return (int)materials.size() - 1;
+    }
+
+    template <class T, class... Args>
+    int make_material(Args &&...args) {
+        return add_material(storage.make<T>(std::forward<Args>(args)...));
+    }
+
+    // textures for the materials above, owned like them
+    template <class T, class... Args>
+    T *make_texture(Args &&...args) {
+        return storage.make<T>(std::forward<Args>(args)...);
+    }
+
+    void add_sphere(const vec3 &center, float radius, int mat) {
+        staged_spheres.push_back({center, radius, mat});
+    }
+
+    // the geometric normal follows the winding: cross(v1 - v0, v2 - v0)
+    void add_triangle(const vec3 &v0, const vec3 &v1, const vec3 &v2, int mat) {
+        staged_triangles.push_back({v0, v1, v2, mat});
+    }
+
+    // A mesh to place with add_instance(), any number of times; its
+    // triangles are stored once. Returns its id.
+    int add_mesh(const std::vector<vec3> &positions, const std::vector<uint32_t> &indices) {
+        shared_mesh &mesh = meshes.emplace_back();
+        pack_triangles(positions, indices, mesh.tree, mesh.packets);
+        return (int)meshes.size() - 1;
+    }
+
+    // the mesh at to_world; an empty mesh or a singular transform adds nothing
+    void add_instance(int mesh, const affine &to_world, int mat) {
+        mesh_instance instance;
+        if (meshes[mesh].packets.empty() || !to_world.inverse(instance.to_object)) return;
+        instance.mesh = uint32_t(mesh);
+        instance.material = uint32_t(mat);
+        instances.push_back(instance);
+    }
+
+    // the unit cube mesh, added on first use: the cube hitable's geometry,
+    // wound so every face normal points out
+    int cube_mesh() {
+        if (cube_mesh_id >= 0) return cube_mesh_id;
+        std::vector<vec3> positions;
+        std::vector<uint32_t> indices;
+        for (const triangle &t : unit_triangles) {
+            vec3 v1 = t.v1, v2 = t.v2;
+            if (dot(cross(v1 - t.v0, v2 - t.v0), t.normal) < 0) std::swap(v1, v2);
+            for (const vec3 &v : {t.v0, v1, v2}) {
+                indices.push_back(uint32_t(positions.size()));
+                positions.push_back(v);
+            }
+        }
+        cube_mesh_id = add_mesh(positions, indices);
+        return cube_mesh_id;
+    }
+
+    void add_cube(const vec3 &position, float size, int mat) {
+        add_instance(cube_mesh(), affine::translate(position) * affine::scale(vec3(size, size, size)), mat);
+    }
+
+    // likewise
+    void add_object(hitable *h) {
+        objects.push_back(h);
+    }
+
+    template <class T, class... Args>
+    T *make_object(Args &&...args) {
+        T *object = storage.make<T>(std::forward<Args>(args)...);
+        add_object(object);
+        return object;
+    }
+
+    // back to an empty scene; destroys what make_*() made but keeps the memory
+    void clear() {
+        materials.clear();
+        sphere_packets.clear();
+        sphere_material.clear();
+        sphere_bvh = bvh_tree();
+        triangle_packets.clear();
+        triangle_material.clear();
+        triangle_bvh = bvh_tree();
+        meshes.clear();
+        instances.clear();
+        instance_bvh = bvh_tree();
+        cube_mesh_id = -1;
+        object_bvh.reset();
+        objects.clear();
+        sphere_view = {};
+        triangle_view = {};
+        bottom_level.clear();
+        top_level = {};
+        emitters.clear();
+        staged_spheres.clear();
+        staged_triangles.clear();
+        linear = false;
+        compiled.reset();
+        storage.reset();
+    }
+
+    size_t arena_bytes() const { return storage.bytes_used(); }
+
+    // use_bvh = false keeps the packets in insertion order and tests all of them
+    void build(bool use_bvh = true) {
+        linear = !use_bvh;
+
+        std::vector<aabb> bounds(staged_spheres.size());
+        for (size_t i = 0; i < staged_spheres.size(); i++) {
+            vec3 r(staged_spheres[i].radius, staged_spheres[i].radius, staged_spheres[i].radius);
+            bounds[i] = aabb(staged_spheres[i].center - r, staged_spheres[i].center + r);
+        }
+        pack(sphere_bvh, bounds, sphere_packets, sphere_material, [&](sphere_packet &p, int lane, int i) {
+            p.set(lane, staged_spheres[i].center, staged_spheres[i].radius);
+            return staged_spheres[i].mat;
+        });
+
+        bounds.resize(staged_triangles.size());
+        for (size_t i = 0; i < staged_triangles.size(); i++) {
+            bounds[i] = aabb();
+            bounds[i].expand(staged_triangles[i].v0);
+            bounds[i].expand(staged_triangles[i].v1);
+            bounds[i].expand(staged_triangles[i].v2);
+        }
+        pack(triangle_bvh, bounds, triangle_packets, triangle_material, [&](triangle_packet &p, int lane, int i) {
+            p.set(lane, staged_triangles[i].v0, staged_triangles[i].v1, staged_triangles[i].v2);
+            return staged_triangles[i].mat;
+        });
+
+        // the top level: instances sorted into the leaves of a BVH over their world bounds
+        instance_bvh = bvh_tree();
+        if (!linear && !instances.empty()) {
+            bounds.resize(instances.size());
+            for (size_t i = 0; i < instances.size(); i++) {
+                affine to_world;
+                instances[i].to_object.inverse(to_world);
+                bounds[i] = to_world.bounds(meshes[instances[i].mesh].tree.bounds());
+            }
+            // an instance test is a transform and a walk down its mesh's tree
+            instance_bvh.build(bounds, 4, 2.0f);
+            std::vector<mesh_instance> sorted(instances.size());
+            for (size_t i = 0; i < instances.size(); i++) sorted[i] = instances[instance_bvh.prim_index[i]];
+            instances.swap(sorted);
+            instance_bvh.prim_index.clear();
+            instance_bvh.prim_index.shrink_to_fit();
+        }
+
+        staged_spheres = {};
+        staged_triangles = {};
+        object_bvh = objects.empty() ? nullptr : std::make_unique<bvh>(objects.data(), (int)objects.size());
+        sphere_view = {sphere_bvh.nodes, sphere_packets, sphere_material};
+        triangle_view = {triangle_bvh.nodes, triangle_packets, triangle_material};
+        bottom_level.clear();
+        for (const shared_mesh &mesh : meshes) bottom_level.push_back({mesh.tree.nodes, mesh.packets, {}});
+        top_level = {instance_bvh.nodes, instances};
+        collect_lights();
+    }
+
+    // Traces the given arrays in place instead of building; the scene keeps
+    // the file they live in mapped for as long as it exists.
+    void use_compiled(packet_view<sphere_packet> spheres, packet_view<triangle_packet> triangles,
+                      std::vector<packet_view<triangle_packet>> meshes, instance_view placed, bool use_bvh,
+                      std::unique_ptr<mapped_file> file) {
+        sphere_view = spheres;
+        triangle_view = triangles;
+        bottom_level = std::move(meshes);
+        top_level = placed;
+        linear = !use_bvh;
+        compiled = std::move(file);
+        collect_lights();
+    }
+
+    virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
+        return traverse<false>(r, t_min, t_max, rec, nullptr);
+    }
+
+    // same as hit() but counts visited nodes and primitive tests
+    bool hit_counted(const ray &r, float t_min, float t_max, hit_record &rec, bvh_traversal_stats &traversal) const {
+        traversal.rays++;
+        return traverse<true>(r, t_min, t_max, rec, &traversal);
+    }
+
+    virtual const light_list *lights() const { return emitters.empty() ? nullptr : &emitters; }
+
+    virtual bool bounding_box(aabb &box) const {
+        box = surrounding_box(view_bounds(sphere_view), view_bounds(triangle_view));
+        if (!top_level.nodes.empty()) box.expand(top_level.nodes[0].bounds);
+        aabb objects_box;
+        if (object_bvh && object_bvh->bounding_box(objects_box)) box.expand(objects_box);
+        return !box.empty();
+    }
+
+    void print_stats() const {
+        fprintf(stderr, "scene: %zu sphere packets, %zu triangle packets, %zu objects, %zu materials, %.1f KB arena\n",
+                sphere_view.packets.size(), triangle_view.packets.size(), objects.size(), materials.size(),
+                storage.bytes_used() / 1e3);
+        if (!top_level.instances.empty()) {
+            size_t mesh_bytes = 0;
+            for (const packet_view<triangle_packet> &mesh : bottom_level) {
+                mesh_bytes += mesh.packets.size_bytes() + mesh.nodes.size_bytes();
+            }
+            fprintf(stderr, "scene: %zu instances of %zu meshes, %.1f KB of instances, %.1f KB of meshes\n",
+                    top_level.instances.size(), bottom_level.size(),
+                    (top_level.instances.size_bytes() + top_level.nodes.size_bytes()) / 1e3, mesh_bytes / 1e3);
+        }
+        if (!emitters.empty()) fprintf(stderr, "scene: %zu area lights\n", emitters.size());
+        if (compiled) {
+            fprintf(stderr, "scene: packets and bvhs mapped from a compiled scene, %.1f MB\n", compiled->size() / 1e6);
+        } else if (!linear) {
+            if (!sphere_packets.empty()) sphere_bvh.stats.print("sphere bvh");
+            if (!triangle_packets.empty()) triangle_bvh.stats.print("triangle bvh");
+            if (!instances.empty()) instance_bvh.stats.print("instance bvh");
+        }
+        if (object_bvh) object_bvh->tree.stats.print("object bvh");
+    }
+
+private:
+    struct staged_sphere {
+        vec3 center;
+        float radius;
+        int mat;
+    };
+    struct staged_triangle {
+        vec3 v0, v1, v2;
+        int mat;
+    };
+    std::vector<staged_sphere> staged_spheres;
+    std::vector<staged_triangle> staged_triangles;
+    bool linear = false;
+    int cube_mesh_id = -1;
+    std::unique_ptr<mapped_file> compiled;
+    arena storage;
+
+    // builds the BVH for one primitive type and bakes each leaf into a packet;
+    // fill(packet, lane, primitive) writes one lane and returns its material id
+    template <class packet_t, class fill_fn>
+    void pack(bvh_tree &tree, const std::vector<aabb> &bounds, std::vector<packet_t> &packets,
+              std::vector<uint32_t> &material_ids, fill_fn &&fill) {
+        packets.clear();
+        material_ids.clear();
+        tree = bvh_tree();
+        int n = (int)bounds.size();
+        if (n == 0) return;
+
+        auto add_packet = [&](int first, int count, auto &&prim) {
+            packet_t packet = {};
+            for (int lane = 0; lane < packet_width; lane++) {
+                material_ids.push_back(lane < count ? fill(packet, lane, prim(first + lane)) : no_material);
+            }
+            packets.push_back(packet);
+        };
+
+        if (linear) {
+            for (int first = 0; first < n; first += packet_width) {
+                add_packet(first, std::min(packet_width, n - first), [](int i) { return i; });
+            }
+            return;
+        }
+        tree.build(bounds, packet_width, 0.25f);
+        for (bvh_node &node : tree.nodes) {
+            if (node.count == 0) continue;
+            int first = node.offset;
+            node.offset = (int)packets.size();
+            add_packet(first, node.count, [&](int i) { return tree.prim_index[i]; });
+        }
+        tree.prim_index.clear();
+        tree.prim_index.shrink_to_fit();
+    }
+
+    const vec3 *emission(uint32_t material_id) const {
+        if (material_id == no_material || materials[material_id]->type != material_light) return nullptr;
+        return &static_cast<const diffuse_light *>(materials[material_id])->emit;
+    }
+
+    // every sphere and triangle with a diffuse_light, instanced ones moved to the world
+    void collect_lights() {
+        emitters.clear();
+        for (size_t i = 0; i < sphere_view.material_ids.size(); i++) {
+            const vec3 *emit = emission(sphere_view.material_ids[i]);
+            if (!emit) continue;
+            const sphere_packet &p = sphere_view.packets[i / packet_width];
+            int lane = int(i % packet_width);
+            emitters.add_sphere(vec3(p.center[0][lane], p.center[1][lane], p.center[2][lane]), p.radius[lane], *emit);
+        }
+        for (size_t i = 0; i < triangle_view.material_ids.size(); i++) {
+            const vec3 *emit = emission(triangle_view.material_ids[i]);
+            if (!emit) continue;
+            vec3 v0, e1, e2;
+            triangle_view.packets[i / packet_width].corners(int(i % packet_width), v0, e1, e2);
+            emitters.add_triangle(v0, e1, e2, *emit);
+        }
+        for (const mesh_instance &instance : top_level.instances) {
+            const vec3 *emit = emission(instance.material);
+            if (!emit) continue;
+            affine to_world;
+            instance.to_object.inverse(to_world);
+            // the empty lanes of a mesh packet have no area and are skipped
+            for (const triangle_packet &p : bottom_level[instance.mesh].packets) {
+                for (int lane = 0; lane < packet_width; lane++) {
+                    vec3 v0, e1, e2;
+                    p.corners(lane, v0, e1, e2);
+                    emitters.add_triangle(to_world.point(v0), to_world.vector(e1), to_world.vector(e2), *emit);
+                }
+            }
+        }
+        emitters.build();
+    }
+
+    // runs test(packet, count, closest) over the packets of one primitive type
+    template <bool count_stats, class packet_t, class test_fn>
+    bool for_each_packet(const packet_view<packet_t> &view, const ray &r, float t_min, float &closest,
+                         bvh_traversal_stats *traversal, test_fn &&test) const {
+        if (!linear) {
+            return bvh_intersect<count_stats>(view.nodes.data(), view.nodes.size(), r, t_min, closest, test, traversal);
+        }
+        bool hit_anything = false;
+        int n = (int)view.packets.size();
+        for (int p = 0; p < n; p++) {
+            // only the last packet of an unsorted list can be partly filled
+            int count = p == n - 1 ? lane_count(view.material_ids, p) : packet_width;
+            if constexpr (count_stats) traversal->prims_tested += count;
+            if (test(p, count, closest)) hit_anything = true;
+        }
+        return hit_anything;
+    }
+
+    template <bool count_stats>
+    bool traverse(const ray &r, float t_min, float t_max, hit_record &rec, bvh_traversal_stats *traversal) const {
+        float closest = t_max;
+        int hit_sphere = -1, hit_triangle = -1;
+
+        sphere_kernel spheres = simd.spheres;
+        for_each_packet<count_stats>(sphere_view, r, t_min, closest, traversal, [&](int p, int count, float &closest_t) {
+            RT_STAT(render_stats::local().prim_tests[prim_sphere_packet]++);
+            int lane = spheres(r, sphere_view.packets[p], count, t_min, closest_t);
+            if (lane < 0) return false;
+            hit_sphere = p * packet_width + lane;
+            return true;
+        });
+
+        triangle_kernel triangles = simd.triangles;
+        for_each_packet<count_stats>(triangle_view, r, t_min, closest, traversal, [&](int p, int count, float &closest_t) {
+            RT_STAT(render_stats::local().prim_tests[prim_triangle_packet]++);
+            int lane = triangles(r, triangle_view.packets[p], count, t_min, closest_t);
+            if (lane < 0) return false;
+            hit_triangle = p * packet_width + lane;
+            hit_sphere = -1;
+            return true;
+        });
+
+        // instances: the ray moves into each mesh's space, t along it stays the same
+        int hit_instance = -1, hit_packet = -1, hit_lane = -1;
+        auto test_instances = [&](int first, int count, float &closest_t) {
+            bool hit_anything = false;
+            for (int i = first; i < first + count; i++) {
+                RT_STAT(render_stats::local().prim_tests[prim_instance]++);
+                const mesh_instance &instance = top_level.instances[i];
+                const packet_view<triangle_packet> &mesh = bottom_level[instance.mesh];
+                ray local = instance.object_ray(r);
+                bvh_intersect<count_stats>(mesh.nodes.data(), mesh.nodes.size(), local, t_min, closest_t,
+                                           [&](int p, int n, float &c) {
+                    RT_STAT(render_stats::local().prim_tests[prim_triangle_packet]++);
+                    int lane = triangles(local, mesh.packets[p], n, t_min, c);
+                    if (lane < 0) return false;
+                    hit_instance = i;
+                    hit_packet = p;
+                    hit_lane = lane;
+                    hit_anything = true;
+                    return true;
+                }, traversal);
+            }
+            return hit_anything;
+        };
+        if (!top_level.instances.empty()) {
+            if (!linear) {
+                bvh_intersect<count_stats>(top_level.nodes.data(), top_level.nodes.size(), r, t_min, closest,
+                                           test_instances, traversal);
+            } else {
+                if constexpr (count_stats) traversal->prims_tested += top_level.instances.size();
+                test_instances(0, (int)top_level.instances.size(), closest);
+            }
+        }
+
+        if (object_bvh) {
+            // only reports a hit closer than any sphere, triangle or instance
+            if (object_bvh->traverse<count_stats>(r, t_min, closest, rec, traversal)) {
+                rec.listed_light = false;
+                return true;
+            }
+        }
+
+        if (hit_instance >= 0) {
+            const mesh_instance &instance = top_level.instances[hit_instance];
+            const triangle_packet &p = bottom_level[instance.mesh].packets[hit_packet];
+            affine to_world;
+            instance.to_object.inverse(to_world);
+            vec3 v0, e1, e2;
+            p.corners(hit_lane, v0, e1, e2);
+            v0 = to_world.point(v0);
+            e1 = to_world.vector(e1);
+            e2 = to_world.vector(e2);
+            rec.t = closest;
+            rec.p = r.point_at_parameter(closest);
+            rec.normal = unit_vector(cross(e1, e2));    // still following the winding, even when mirrored
+            rec.mat_ptr = materials[instance.material];
+            rec.listed_light = true;
+            set_triangle_uv(v0, e1, e2, rec);
+            return true;
+        }
+        if (hit_triangle >= 0 && hit_sphere < 0) {
+            const triangle_packet &p = triangle_view.packets[hit_triangle / packet_width];
+            rec.t = closest;
+            rec.p = r.point_at_parameter(closest);
+            rec.normal = p.normal(hit_triangle % packet_width);
+            rec.mat_ptr = materials[triangle_view.material_ids[hit_triangle]];
+            rec.listed_light = true;
+            vec3 v0, e1, e2;
+            p.corners(hit_triangle % packet_width, v0, e1, e2);
+            set_triangle_uv(v0, e1, e2, rec);
+            return true;
+        }
+        if (hit_sphere >= 0) {
+            const sphere_packet &p = sphere_view.packets[hit_sphere / packet_width];
+            int lane = hit_sphere % packet_width;
+            vec3 center(p.center[0][lane], p.center[1][lane], p.center[2][lane]);
+            rec.t = closest;
+            rec.p = r.point_at_parameter(closest);
+            rec.normal = (rec.p - center) / p.radius[lane];
+            rec.mat_ptr = materials[sphere_view.material_ids[hit_sphere]];
+            rec.listed_light = true;
+            set_sphere_uv(p.radius[lane], rec);
+            return true;
+        }
+        return false;
+    }
+
+    template <class packet_t>
+    static aabb view_bounds(const packet_view<packet_t> &view) {
+        return view.nodes.empty() ? aabb() : view.nodes[0].bounds;
+    }
+
+    static int lane_count(std::span<const uint32_t> material_ids, int packet) {
+        int count = 0;
+        while (count < packet_width && material_ids[packet * packet_width + count] != no_material) count++;
+        return count;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_SCENE_H
@@ -0,0 +1,645 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_SCENE_FILE_H
+#define CPU_CPP_RAYTRACING_SCENE_FILE_H
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "image_texture.h"
+#include "mapped_file.h"
+#include "materials.h"
+#include "obj_loader.h"
+#include "scene.h"
+#include "scenes.h"
+#include "texture.h"
+
+// Scene description files. One statement per line, '#' starts a comment:
+//
+//   camera lookfrom X Y Z lookat X Y Z vup X Y Z fov DEGREES   (any of the keys)
+//   texture NAME image FILE [uv|planar] [SCALE]     a PPM or PFM, see image_texture.h
+//   texture NAME noise fbm|marble R G B R G B SCALE
+//   material NAME lambertian R G B
+//   material NAME lambertian texture TEXTURE
+//   material NAME metal R G B FUZZ
+//   material NAME metal texture TEXTURE FUZZ
+//   material NAME dielectric INDEX
+//   material NAME light R G B            emits R G B from the front; see light.h
+//   sphere X Y Z RADIUS MATERIAL
+//   cube X Y Z SIZE MATERIAL
+//   triangle X Y Z X Y Z X Y Z MATERIAL
+//   mesh FILE.obj X Y Z SIZE MATERIAL    fitted into a SIZE box centered at X Y Z
+//   instance FILE.obj X Y Z SIZE MATERIAL [DEGREES]
+//                                        the same, turned DEGREES about y, but
+//                                        sharing one copy of the mesh between
+//                                        all instances of FILE.obj
+//   set OPTION [VALUE]                   a command line option without the "--";
+//                                        the real command line overrides it
+//
+// Relative paths are relative to the scene file. Meshes are flattened into
+// the scene's triangle packets; cubes and instances are placed copies of
+// shared meshes (see scene.h).
+//
+// After the first load the built scene is written next to the text as
+// FILE.bin: the packets, BVH nodes and material ids exactly as they are in
+// memory (instances and shared meshes too), each section 64-byte aligned. Later loads map that file and trace
+// it in place, so startup costs a few page faults instead of parsing, OBJ
+// loading and BVH builds. The cache is rebuilt when the text or a mesh it
+// uses changes, when --accel differs, or when the packet layout of the
+// build does not match. Image textures are not in it, only their paths;
+// their tiles stay in their own FILE.tiles (see image_texture.h).
+
+// where the camera is, from the file or the built-in view
+struct scene_camera {
+    vec3 lookfrom = vec3(1, 0.5, -0.5);
+    vec3 lookat = vec3(0, 0, -1);
+    vec3 vup = vec3(0, 1, 0);
+    float fov = 45;
+};
+
+enum compiled_texture_type : uint32_t { texture_image, texture_noise };
+
+// enough to recreate one of the textures a scene file can declare
+struct compiled_texture {
+    uint32_t type;
+    uint32_t mode;          // image: image_texture::mapping, noise: noise_texture::pattern
+    float params[7];        // image: scale, noise: low, high, scale
+    uint32_t path_offset;   // image: its file, in the texture paths section
+    uint32_t path_bytes;
+
+    // nullptr if the image cannot be read
+    const texture *add_to(scene &world, const std::string &path) const {
+        if (type == texture_noise) {
+            return world.make_texture<noise_texture>(vec3(params[0], params[1], params[2]),
+                                                     vec3(params[3], params[4], params[5]), params[6],
+                                                     noise_texture::pattern(mode));
+        }
+        std::unique_ptr<tiled_image> image = tiled_image::open(path);
+        if (!image) return nullptr;
+        return world.make_texture<image_texture>(std::move(image), image_texture::mapping(mode), params[0]);
+    }
+};
+
+// enough to recreate one of the materials a scene file can declare
+struct compiled_material {
+    uint32_t type;
+    float params[4];    // lambertian: albedo, metal: albedo and fuzz, dielectric: refraction index, light: emission
+    int32_t texture;    // albedo texture instead of the color, -1 for none
+
+    int add_to(scene &world, const std::vector<const class texture *> &textures) const {
+        vec3 albedo(params[0], params[1], params[2]);
+        const class texture *t = texture >= 0 ? textures[texture] : nullptr;
+        if (type == material_metal) {
+            return t ? world.make_material<metal>(t, params[3]) : world.make_material<metal>(albedo, params[3]);
+        }
+        if (type == material_dielectric) return world.make_material<dielectric>(params[0]);
+        if (type == material_light) return world.make_material<diffuse_light>(albedo);
+        return t ? world.make_material<lambertian>(t) : world.make_material<lambertian>(albedo);
+    }
+};
+
+struct compiled_section {
+    uint64_t offset = 0;    // bytes from the start of the file
+    uint64_t count = 0;     // elements
+};
+
+// where one shared mesh is in the mesh node and packet sections
+struct compiled_mesh {
+    uint64_t first_node, node_count;
+    uint64_t first_packet, packet_count;
+};
+
+struct compiled_scene_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t packet_width;      // the layout of the build that wrote it
+    uint32_t node_bytes;
+    uint32_t sphere_packet_bytes;
+    uint32_t triangle_packet_bytes;
+    uint32_t use_bvh;
+    scene_camera camera;
+    compiled_section textures;          // compiled_texture
+    compiled_section texture_paths;     // their image files, concatenated
+    compiled_section materials;         // compiled_material
+    compiled_section settings;          // "--option\0value\0..."
+    compiled_section dependencies;      // "size\tmtime\tpath\n" per input file
+    compiled_section sphere_nodes, sphere_packets, sphere_materials;
+    compiled_section triangle_nodes, triangle_packets, triangle_materials;
+    compiled_section meshes, mesh_nodes, mesh_packets;      // compiled_mesh, bvh_node, triangle_packet
+    compiled_section instances, instance_nodes;             // mesh_instance, bvh_node
+};
+
+struct scene_load_stats {
+    bool from_cache = false;
+    double parse_ms = 0;    // text and meshes
+    double build_ms = 0;    // packets and BVHs
+    double map_ms = 0;      // opening and checking the compiled scene
+    double write_ms = 0;    // writing it
+    size_t cache_bytes = 0;
+    bool cache_written = false;
+
+    void print(const char *name) const {
+        if (from_cache) {
+            fprintf(stderr, "%s: mapped %.1f MB compiled scene in %.2f ms\n", name, cache_bytes / 1e6, map_ms);
+            return;
+        }
+        fprintf(stderr, "%s: parsed in %.1f ms, built in %.1f ms", name, parse_ms, build_ms);
+        if (cache_written) fprintf(stderr, ", compiled scene written in %.1f ms", write_ms);
+        fprintf(stderr, "\n");
+    }
+};
+
+class scene_file {
+public:
+    scene_camera camera;
+    std::vector<std::string> settings;      // "--option" [value] tokens, to go before the command line
+    scene_load_stats stats;
+
+    // Reads the camera and settings, from a valid compiled scene if use_cache,
+    // otherwise from the text, which is parsed into world (emptied first).
+    bool load(const std::string &scene_path, bool use_cache, scene &world) {
+        path = scene_path;
+        cache_path = path + ".bin";
+        caching = use_cache;
+        parsed = false;
+        stats = scene_load_stats();
+        world.clear();
+        if (caching && open_cache()) return true;
+        return parse(world);
+    }
+
+    // Makes world ready to trace: the mapped compiled scene if it was built
+    // with the same use_bvh, otherwise built from the text (and cached).
+    bool build(bool use_bvh, scene &world) {
+        if (cache && header()->use_bvh == uint32_t(use_bvh)) return map_cached(world);
+        cache.reset();
+        if (!parsed && !parse(world)) return false;
+
+        auto start = std::chrono::steady_clock::now();
+        world.build(use_bvh);
+        stats.build_ms = ms_since(start);
+        if (caching) {
+            start = std::chrono::steady_clock::now();
+            stats.cache_written = write_cache(world, use_bvh);
+            if (!stats.cache_written) fprintf(stderr, "cannot write %s\n", cache_path.c_str());
+            stats.write_ms = ms_since(start);
+        }
+        return true;
+    }
+
+    // the files the scene was made from as they are now, one file_stamp() each
+    std::string input_stamps() const {
+        std::string stamps;
+        for (const std::string &d : dependencies) stamps += file_stamp(d);
+        for (const std::string &i : images) stamps += file_stamp(i);
+        return stamps;
+    }
+
+private:
+    static constexpr char magic[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', 0};
+    static const uint32_t version = 3;
+    static const size_t section_alignment = 64;
+
+    std::string path, cache_path;
+    bool caching = false;
+    std::unique_ptr<mapped_file> cache;
+    bool parsed = false;                        // the text is in the world, not built yet
+    std::vector<compiled_texture> texture_records;
+    std::string texture_paths;
+    std::vector<compiled_material> material_records;
+    std::vector<std::string> dependencies;      // the scene file and its meshes
+    std::vector<std::string> images;            // texture sources, read through their tiles
+
+    static double ms_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const compiled_scene_header *header() const {
+        return (const compiled_scene_header *)cache->data();
+    }
+
+    template <class T>
+    std::span<const T> section(const compiled_section &s) const {
+        return {(const T *)(cache->data() + s.offset), size_t(s.count)};
+    }
+
+    // one material id per packet lane, each a material or none
+    bool valid_lanes(const compiled_section &ids, uint64_t packets, uint64_t materials) const {
+        if (ids.count != packets * packet_width) return false;
+        for (uint32_t id : section<uint32_t>(ids)) {
+            if (id >= materials && id != scene::no_material) return false;
+        }
+        return true;
+    }
+
+    // Children come after their parent, so traversal ends, and no deeper than
+    // its stack; leaves stay inside the items they index, one packet of up to
+    // packet_width lanes or count instances.
+    static bool valid_tree(std::span<const bvh_node> nodes, uint64_t items, bool packet_leaves) {
+        std::vector<uint8_t> depth(nodes.size(), 0);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const bvh_node &node = nodes[i];
+            if (node.offset < 0 || node.axis > 2) return false;
+            size_t offset = size_t(node.offset);
+            if (node.count == 0) {
+                if (offset <= i + 1 || offset >= nodes.size() || depth[i] >= 127) return false;
+                depth[i + 1] = std::max<uint8_t>(depth[i + 1], depth[i] + 1);
+                depth[offset] = std::max<uint8_t>(depth[offset], depth[i] + 1);
+            } else if (packet_leaves ? node.count > packet_width || offset >= items : offset + node.count > items) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool open_cache() {
+        auto start = std::chrono::steady_clock::now();
+        auto file = std::make_unique<mapped_file>();
+        if (!file->open(cache_path, false) || file->size() < sizeof(compiled_scene_header)) return false;
+        cache = std::move(file);
+        const compiled_scene_header &h = *header();
+        // the packets are traced in place and need their alignment (a read-in copy may not have it)
+        bool valid = uintptr_t(cache->data()) % section_alignment == 0 && !memcmp(h.magic, magic, sizeof(magic)) &&
+                     h.version == version && h.packet_width == packet_width && h.node_bytes == sizeof(bvh_node) &&
+                     h.sphere_packet_bytes == sizeof(sphere_packet) &&
+                     h.triangle_packet_bytes == sizeof(triangle_packet);
+        const compiled_section *sections[] = {&h.textures, &h.texture_paths, &h.materials, &h.settings,
+                                              &h.dependencies, &h.sphere_nodes, &h.sphere_packets,
+                                              &h.sphere_materials, &h.triangle_nodes, &h.triangle_packets,
+                                              &h.triangle_materials, &h.meshes, &h.mesh_nodes, &h.mesh_packets,
+                                              &h.instances, &h.instance_nodes};
+        const size_t element_bytes[] = {sizeof(compiled_texture), 1, sizeof(compiled_material), 1, 1,
+                                        sizeof(bvh_node), sizeof(sphere_packet), sizeof(uint32_t), sizeof(bvh_node),
+                                        sizeof(triangle_packet), sizeof(uint32_t), sizeof(compiled_mesh),
+                                        sizeof(bvh_node), sizeof(triangle_packet), sizeof(mesh_instance),
+                                        sizeof(bvh_node)};
+        for (int k = 0; valid && k < 16; k++) {
+            const compiled_section &s = *sections[k];
+            valid = s.offset % section_alignment == 0 && s.offset <= cache->size() &&
+                    s.count <= (cache->size() - s.offset) / element_bytes[k];
+        }
+        if (valid) {
+            for (const compiled_texture &t : section<compiled_texture>(h.textures)) {
+                valid = valid && uint64_t(t.path_offset) + t.path_bytes <= h.texture_paths.count;
+            }
+            size_t texture_count = h.textures.count;
+            for (const compiled_material &m : section<compiled_material>(h.materials)) {
+                valid = valid && m.texture >= -1 && m.texture < int64_t(texture_count);
+            }
+            valid = valid && valid_lanes(h.sphere_materials, h.sphere_packets.count, h.materials.count) &&
+                    valid_lanes(h.triangle_materials, h.triangle_packets.count, h.materials.count) &&
+                    valid_tree(section<bvh_node>(h.sphere_nodes), h.sphere_packets.count, true) &&
+                    valid_tree(section<bvh_node>(h.triangle_nodes), h.triangle_packets.count, true) &&
+                    valid_tree(section<bvh_node>(h.instance_nodes), h.instances.count, false);
+            std::span<const bvh_node> mesh_nodes = section<bvh_node>(h.mesh_nodes);
+            for (const compiled_mesh &m : section<compiled_mesh>(h.meshes)) {
+                valid = valid && m.first_node <= h.mesh_nodes.count &&
+                        m.node_count <= h.mesh_nodes.count - m.first_node &&
+                        m.first_packet <= h.mesh_packets.count &&
+                        m.packet_count <= h.mesh_packets.count - m.first_packet &&
+                        valid_tree(mesh_nodes.subspan(m.first_node, m.node_count), m.packet_count, true);
+            }
+            for (const mesh_instance &i : section<mesh_instance>(h.instances)) {
+                valid = valid && i.mesh < h.meshes.count && i.material < h.materials.count;
+            }
+        }
+        if (valid) {
+            // every input must still be the one the cache was built from
+            std::span<const char> deps = section<char>(h.dependencies);
+            std::string_view rest(deps.data(), deps.size());
+            dependencies.clear();
+            while (valid && !rest.empty()) {
+                size_t eol = rest.find('\n');
+                size_t tab = rest.find('\t', rest.find('\t') + 1);
+                if (eol != std::string_view::npos && tab < eol) {
+                    dependencies.emplace_back(rest.substr(tab + 1, eol - tab - 1));
+                }
+                valid = eol != std::string_view::npos && tab < eol &&
+                        file_stamp(dependencies.back()) == rest.substr(0, eol + 1);
+                if (valid) rest.remove_prefix(eol + 1);
+            }
+        }
+        if (!valid) {
+            cache.reset();
+            return false;
+        }
+
+        camera = h.camera;
+        settings.clear();
+        std::span<const char> blob = section<char>(h.settings);
+        for (size_t i = 0; i < blob.size(); i += settings.back().size() + 1) {
+            settings.emplace_back(blob.data() + i, strnlen(blob.data() + i, blob.size() - i));
+        }
+        stats.from_cache = true;
+        stats.cache_bytes = cache->size();
+        stats.map_ms = ms_since(start);
+        return true;
+    }
+
+    bool map_cached(scene &world) {
+        auto start = std::chrono::steady_clock::now();
+        const compiled_scene_header &h = *header();
+        std::span<const char> paths = section<char>(h.texture_paths);
+        std::vector<const texture *> textures;
+        images.clear();
+        for (const compiled_texture &t : section<compiled_texture>(h.textures)) {
+            std::string image_path(paths.data() + t.path_offset, t.path_bytes);
+            if (t.type == texture_image) images.push_back(image_path);
+            textures.push_back(t.add_to(world, image_path));
+            if (!textures.back()) return false;
+        }
+        for (const compiled_material &m : section<compiled_material>(h.materials)) m.add_to(world, textures);
+        scene::packet_view<sphere_packet> spheres = {section<bvh_node>(h.sphere_nodes),
+                                                     section<sphere_packet>(h.sphere_packets),
+                                                     section<uint32_t>(h.sphere_materials)};
+        scene::packet_view<triangle_packet> triangles = {section<bvh_node>(h.triangle_nodes),
+                                                         section<triangle_packet>(h.triangle_packets),
+                                                         section<uint32_t>(h.triangle_materials)};
+        std::span<const bvh_node> mesh_nodes = section<bvh_node>(h.mesh_nodes);
+        std::span<const triangle_packet> mesh_packets = section<triangle_packet>(h.mesh_packets);
+        std::vector<scene::packet_view<triangle_packet>> meshes;
+        for (const compiled_mesh &m : section<compiled_mesh>(h.meshes)) {
+            meshes.push_back({mesh_nodes.subspan(m.first_node, m.node_count),
+                              mesh_packets.subspan(m.first_packet, m.packet_count), {}});
+        }
+        scene::instance_view instances = {section<bvh_node>(h.instance_nodes), section<mesh_instance>(h.instances)};
+        world.use_compiled(spheres, triangles, std::move(meshes), instances, h.use_bvh != 0, std::move(cache));
+        stats.map_ms += ms_since(start);
+        return true;
+    }
+
+    bool write_cache(const scene &world, bool use_bvh) {
+        if (!world.objects.empty()) return true;    // only packets can be mapped back
+        std::string temp_path = cache_path + ".tmp";
+        FILE *f = fopen(temp_path.c_str(), "wb");
+        if (!f) return false;
+
+        std::string settings_blob, dependency_blob;
+        for (const std::string &s : settings) settings_blob.append(s.c_str(), s.size() + 1);
+        for (const std::string &d : dependencies) dependency_blob += file_stamp(d);
+
+        compiled_scene_header h = {};
+        memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.packet_width = packet_width;
+        h.node_bytes = sizeof(bvh_node);
+        h.sphere_packet_bytes = sizeof(sphere_packet);
+        h.triangle_packet_bytes = sizeof(triangle_packet);
+        h.use_bvh = use_bvh;
+        h.camera = camera;
+
+        // the header is written again at the end, once the offsets are known
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+        uint64_t offset = sizeof(h);
+        auto put = [&](compiled_section &s, const void *data, size_t count, size_t element_bytes) {
+            static const char zeros[section_alignment] = {};
+            uint64_t aligned = (offset + section_alignment - 1) / section_alignment * section_alignment;
+            ok = ok && fwrite(zeros, 1, aligned - offset, f) == aligned - offset;
+            ok = ok && fwrite(data, element_bytes, count, f) == count;
+            s = {aligned, count};
+            offset = aligned + count * element_bytes;
+        };
+        put(h.textures, texture_records.data(), texture_records.size(), sizeof(compiled_texture));
+        put(h.texture_paths, texture_paths.data(), texture_paths.size(), 1);
+        put(h.materials, material_records.data(), material_records.size(), sizeof(compiled_material));
+        put(h.settings, settings_blob.data(), settings_blob.size(), 1);
+        put(h.dependencies, dependency_blob.data(), dependency_blob.size(), 1);
+        put(h.sphere_nodes, world.sphere_bvh.nodes.data(), world.sphere_bvh.nodes.size(), sizeof(bvh_node));
+        put(h.sphere_packets, world.sphere_packets.data(), world.sphere_packets.size(), sizeof(sphere_packet));
+        put(h.sphere_materials, world.sphere_material.data(), world.sphere_material.size(), sizeof(uint32_t));
+        put(h.triangle_nodes, world.triangle_bvh.nodes.data(), world.triangle_bvh.nodes.size(), sizeof(bvh_node));
+        put(h.triangle_packets, world.triangle_packets.data(), world.triangle_packets.size(), sizeof(triangle_packet));
+        put(h.triangle_materials, world.triangle_material.data(), world.triangle_material.size(), sizeof(uint32_t));
+        // the meshes end to end
+        std::vector<compiled_mesh> mesh_records;
+        std::vector<bvh_node> mesh_nodes;
+        std::vector<triangle_packet> mesh_packets;
+        for (const scene::shared_mesh &mesh : world.meshes) {
+            mesh_records.push_back({mesh_nodes.size(), mesh.tree.nodes.size(), mesh_packets.size(), mesh.packets.size()});
+            mesh_nodes.insert(mesh_nodes.end(), mesh.tree.nodes.begin(), mesh.tree.nodes.end());
+            mesh_packets.insert(mesh_packets.end(), mesh.packets.begin(), mesh.packets.end());
+        }
+        put(h.meshes, mesh_records.data(), mesh_records.size(), sizeof(compiled_mesh));
+        put(h.mesh_nodes, mesh_nodes.data(), mesh_nodes.size(), sizeof(bvh_node));
+        put(h.mesh_packets, mesh_packets.data(), mesh_packets.size(), sizeof(triangle_packet));
+        put(h.instances, world.instances.data(), world.instances.size(), sizeof(mesh_instance));
+        put(h.instance_nodes, world.instance_bvh.nodes.data(), world.instance_bvh.nodes.size(), sizeof(bvh_node));
+        ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+        ok = fclose(f) == 0 && ok;
+        // readers never see a half written cache
+        if (ok) ok = std::rename(temp_path.c_str(), cache_path.c_str()) == 0;
+        if (!ok) std::remove(temp_path.c_str());
+        return ok;
+    }
+
+    // splits one line into tokens, up to a comment
+    static void tokenize(const char *p, const char *end, std::vector<std::string_view> &tokens) {
+        tokens.clear();
+        while (true) {
+            p = skip_spaces(p, end);
+            if (p >= end || *p == '\n' || *p == '\r' || *p == '#') return;
+            const char *start = p;
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') p++;
+            tokens.emplace_back(start, p - start);
+        }
+    }
+
+    static bool to_float(std::string_view token, float &value) {
+        auto res = std::from_chars(token.data(), token.data() + token.size(), value);
+        return res.ec == std::errc() && res.ptr == token.data() + token.size();
+    }
+
+    bool parse(scene &world) {
+        auto start = std::chrono::steady_clock::now();
+        mapped_file file;
+        if (!file.open(path)) {
+            fprintf(stderr, "cannot open %s\n", path.c_str());
+            return false;
+        }
+        world.clear();
+        camera = scene_camera();
+        settings.clear();
+        texture_records.clear();
+        texture_paths.clear();
+        material_records.clear();
+        dependencies = {path};
+        images.clear();
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+        std::unordered_map<std::string_view, int> texture_ids, material_ids;
+        std::unordered_map<std::string, int> mesh_ids;      // by path, for instances
+        std::vector<const texture *> textures;
+        std::vector<std::string_view> tokens;
+        std::vector<vec3> positions;
+        std::vector<uint32_t> indices;
+        const char *p = file.data();
+        const char *end = p + file.size();
+        for (int line = 1; p < end; p = skip_line(p, end), line++) {
+            tokenize(p, end, tokens);
+            if (tokens.empty()) continue;
+            auto fail = [&](const char *what) {
+                fprintf(stderr, "%s:%d: %s\n", path.c_str(), line, what);
+                return false;
+            };
+            // numbers[first, first + count) must all parse
+            float numbers[10] = {};
+            auto parse_numbers = [&](size_t first, size_t count) {
+                if (tokens.size() < first + count) return false;
+                for (size_t k = 0; k < count; k++) {
+                    if (!to_float(tokens[first + k], numbers[k])) return false;
+                }
+                return true;
+            };
+            auto find_material = [&](std::string_view name, int &id) {
+                auto it = material_ids.find(name);
+                if (it == material_ids.end()) return false;
+                id = it->second;
+                return true;
+            };
+            std::string_view keyword = tokens[0];
+            int mat;
+
+            if (keyword == "camera") {
+                for (size_t k = 1; k < tokens.size(); k += 2) {
+                    std::string_view key = tokens[k];
+                    vec3 *v = key == "lookfrom" ? &camera.lookfrom : key == "lookat" ? &camera.lookat
+                            : key == "vup" ? &camera.vup : nullptr;
+                    if (v && parse_numbers(k + 1, 3)) {
+                        *v = vec3(numbers[0], numbers[1], numbers[2]);
+                        k += 2;
+                    } else if (key == "fov" && parse_numbers(k + 1, 1)) {
+                        camera.fov = numbers[0];
+                    } else {
+                        return fail("bad camera");
+                    }
+                }
+            } else if (keyword == "texture") {
+                if (tokens.size() < 4) return fail("bad texture");
+                compiled_texture t = {};
+                std::string_view type = tokens[2];
+                std::string image_path;
+                if (type == "image" && tokens.size() <= 6) {
+                    t.type = texture_image;
+                    t.mode = image_texture::map_uv;
+                    numbers[0] = 1;
+                    size_t k = 4;
+                    if (k < tokens.size() && (tokens[k] == "uv" || tokens[k] == "planar")) {
+                        if (tokens[k++] == "planar") t.mode = image_texture::map_planar;
+                    }
+                    if (k < tokens.size() && !(k + 1 == tokens.size() && to_float(tokens[k], numbers[0]))) {
+                        return fail("bad texture");
+                    }
+                    if (!(numbers[0] > 0)) return fail("bad texture");
+                    image_path = (directory / std::string(tokens[3])).string();
+                    t.path_offset = uint32_t(texture_paths.size());
+                    t.path_bytes = uint32_t(image_path.size());
+                    texture_paths += image_path;
+                    images.push_back(image_path);
+                } else if (type == "noise" && tokens.size() == 11 && (tokens[3] == "fbm" || tokens[3] == "marble") &&
+                           parse_numbers(4, 7)) {
+                    t.type = texture_noise;
+                    t.mode = tokens[3] == "marble" ? noise_texture::pattern_marble : noise_texture::pattern_fbm;
+                } else {
+                    return fail("bad texture");
+                }
+                memcpy(t.params, numbers, sizeof(t.params));
+                if (!texture_ids.emplace(tokens[1], (int)texture_records.size()).second) {
+                    return fail("texture declared twice");
+                }
+                const texture *made = t.add_to(world, image_path);
+                if (!made) return fail("cannot load texture");
+                texture_records.push_back(t);
+                textures.push_back(made);
+            } else if (keyword == "material") {
+                if (tokens.size() < 3) return fail("bad material");
+                compiled_material m = {};
+                m.texture = -1;
+                std::string_view type = tokens[2];
+                bool textured = tokens.size() > 3 && tokens[3] == "texture";
+                if (textured) {
+                    auto it = texture_ids.find(tokens.size() > 4 ? tokens[4] : std::string_view());
+                    if (it == texture_ids.end()) return fail("unknown texture");
+                    m.texture = it->second;
+                }
+                if (type == "lambertian" && textured && tokens.size() == 5) m.type = material_lambertian;
+                else if (type == "lambertian" && tokens.size() == 6 && parse_numbers(3, 3)) m.type = material_lambertian;
+                else if (type == "metal" && textured && tokens.size() == 6 && parse_numbers(5, 1)) {
+                    m.type = material_metal;
+                    numbers[3] = numbers[0];
+                    numbers[0] = numbers[1] = numbers[2] = 1;
+                }
+                else if (type == "metal" && tokens.size() == 7 && parse_numbers(3, 4)) m.type = material_metal;
+                else if (type == "dielectric" && tokens.size() == 4 && parse_numbers(3, 1)) m.type = material_dielectric;
+                else if (type == "light" && tokens.size() == 6 && parse_numbers(3, 3)) m.type = material_light;
+                else return fail("bad material");
+                memcpy(m.params, numbers, sizeof(m.params));
+                if (!material_ids.emplace(tokens[1], (int)material_records.size()).second) {
+                    return fail("material declared twice");
+                }
+                material_records.push_back(m);
+                m.add_to(world, textures);
+            } else if (keyword == "sphere" || keyword == "cube") {
+                if (tokens.size() != 6 || !parse_numbers(1, 4)) return fail("bad sphere or cube");
+                if (!find_material(tokens[5], mat)) return fail("unknown material");
+                vec3 center(numbers[0], numbers[1], numbers[2]);
+                if (keyword == "sphere") world.add_sphere(center, numbers[3], mat);
+                else world.add_cube(center, numbers[3], mat);
+            } else if (keyword == "triangle") {
+                if (tokens.size() != 11 || !parse_numbers(1, 9)) return fail("bad triangle");
+                if (!find_material(tokens[10], mat)) return fail("unknown material");
+                world.add_triangle(vec3(numbers[0], numbers[1], numbers[2]), vec3(numbers[3], numbers[4], numbers[5]),
+                                     vec3(numbers[6], numbers[7], numbers[8]), mat);
+            } else if (keyword == "mesh") {
+                if (tokens.size() != 7 || !parse_numbers(2, 4)) return fail("bad mesh");
+                if (!find_material(tokens[6], mat)) return fail("unknown material");
+                std::string mesh_path = (directory / std::string(tokens[1])).string();
+                if (!load_obj(mesh_path, positions, indices)) return fail("cannot load mesh");
+                fit_mesh(positions, vec3(numbers[0], numbers[1], numbers[2]), numbers[3]);
+                for (size_t k = 0; k + 2 < indices.size(); k += 3) {
+                    world.add_triangle(positions[indices[k]], positions[indices[k + 1]], positions[indices[k + 2]], mat);
+                }
+                dependencies.push_back(mesh_path);
+            } else if (keyword == "instance") {
+                if ((tokens.size() != 7 && tokens.size() != 8) || !parse_numbers(2, 4)) return fail("bad instance");
+                if (!find_material(tokens[6], mat)) return fail("unknown material");
+                float degrees = 0;
+                if (tokens.size() == 8 && !to_float(tokens[7], degrees)) return fail("bad instance");
+                if (!(numbers[3] > 0)) return fail("bad instance");     // a singular transform has no inverse
+                std::string mesh_path = (directory / std::string(tokens[1])).string();
+                auto it = mesh_ids.find(mesh_path);
+                if (it == mesh_ids.end()) {
+                    if (!load_obj(mesh_path, positions, indices)) return fail("cannot load mesh");
+                    fit_mesh(positions, vec3(0, 0, 0), 1);
+                    it = mesh_ids.emplace(mesh_path, world.add_mesh(positions, indices)).first;
+                    dependencies.push_back(mesh_path);
+                }
+                affine to_world = affine::translate(vec3(numbers[0], numbers[1], numbers[2])) *
+                                  affine::rotate(vec3(0, 1, 0), degrees) *
+                                  affine::scale(vec3(numbers[3], numbers[3], numbers[3]));
+                world.add_instance(it->second, to_world, mat);
+            } else if (keyword == "set") {
+                if (tokens.size() < 2 || tokens.size() > 3 || tokens[1] == "scene") return fail("bad setting");
+                settings.push_back("--" + std::string(tokens[1]));
+                if (tokens.size() == 3) settings.emplace_back(tokens[2]);
+            } else {
+                return fail("unknown statement");
+            }
+        }
+        parsed = true;
+        stats.from_cache = false;
+        stats.parse_ms = ms_since(start);
+        return true;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_SCENE_FILE_H
@@ -0,0 +1,188 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_SCENES_H
+#define CPU_CPP_RAYTRACING_SCENES_H
+#include <cmath>
+#include <string>
+#include <vector>
+#include "light.h"
+#include "materials.h"
+#include "obj_loader.h"
+#include "sampler.h"
+#include "scene.h"
+#include "triangle_mesh.h"
+
+// the original hard-coded scene: two spheres, a diffuse and a glass cube on a big ground sphere
+void default_scene(scene &world) {
+    world.add_sphere(vec3(0, 0, -1), 0.2, world.make_material<lambertian>(vec3(0.8, 0.3, 0.3)));
+    world.add_sphere(vec3(0, -100.5, -1), 100, world.make_material<lambertian>(vec3(0.8, 0.8, 0.0)));
+    world.add_cube(vec3(-0.7,0,-1),0.5,world.make_material<lambertian>(vec3(0.2,0.1,0.9)));
+    world.add_cube(vec3(0.0,0,-1),0.5,world.make_material<dielectric>(1.5));
+    world.add_sphere(vec3(0.5,0,-1.2),0.2,world.make_material<metal>(vec3(0.0,1,0.7),0.1));
+}
+
+// the default layout with noise-textured and bump-mapped surfaces: marble
+// ground, a stone cube, a hammered metal sphere and a bumpy clay sphere
+void procedural_scene(scene &world) {
+    fbm_settings fine;
+    fine.octaves = 6;
+    texture *marble = world.make_texture<noise_texture>(vec3(0.85, 0.83, 0.78), vec3(0.25, 0.22, 0.2), 4,
+                                                        noise_texture::pattern_marble);
+    texture *stone = world.make_texture<noise_texture>(vec3(0.15, 0.2, 0.45), vec3(0.55, 0.6, 0.8), 12,
+                                                       noise_texture::pattern_fbm, fine);
+    material *clay = world.materials[world.make_material<lambertian>(vec3(0.8, 0.3, 0.3))];
+    material *steel = world.materials[world.make_material<metal>(vec3(0.0, 1, 0.7), 0.05)];
+
+    world.add_sphere(vec3(0, 0, -1), 0.2, world.make_material<bump>(clay, 30, 0.4f));
+    world.add_sphere(vec3(0, -100.5, -1), 100, world.make_material<lambertian>(marble));
+    world.add_cube(vec3(-0.7, 0, -1), 0.5, world.make_material<lambertian>(stone));
+    world.add_cube(vec3(0.0, 0, -1), 0.5, world.make_material<dielectric>(1.5));
+    world.add_sphere(vec3(0.5, 0, -1.2), 0.2, world.make_material<bump>(steel, 60, 0.15f, fine));
+}
+
+// two triangles on the parallelogram corner, corner + u, corner + u + v,
+// corner + v, facing cross(u, v)
+void add_quad(scene &world, const vec3 &corner, const vec3 &u, const vec3 &v, int mat) {
+    world.add_triangle(corner, corner + u, corner + u + v, mat);
+    world.add_triangle(corner, corner + u + v, corner + v, mat);
+}
+
+// The default layout in a closed room around the default camera, lit only
+// by a small panel in the ceiling and a small warm lamp: no path escapes to
+// the sky, so everything it sees is direct or bounced light from the two.
+void interior_scene(scene &world) {
+    int white = world.make_material<lambertian>(vec3(0.73, 0.73, 0.73));
+    int red = world.make_material<lambertian>(vec3(0.65, 0.05, 0.05));
+    int green = world.make_material<lambertian>(vec3(0.12, 0.45, 0.15));
+    const float x0 = -1.8f, x1 = 1.8f, y0 = -0.5f, y1 = 1.4f, z0 = -2.5f, z1 = 0.8f;
+    vec3 dx(x1 - x0, 0, 0), dy(0, y1 - y0, 0), dz(0, 0, z1 - z0);
+    // every wall faces into the room
+    add_quad(world, vec3(x0, y0, z0), dz, dx, white);     // floor
+    add_quad(world, vec3(x0, y1, z0), dx, dz, white);     // ceiling
+    add_quad(world, vec3(x0, y0, z0), dx, dy, white);     // back
+    add_quad(world, vec3(x0, y0, z1), dy, dx, white);     // front, behind the camera
+    add_quad(world, vec3(x0, y0, z0), dy, dz, red);       // left
+    add_quad(world, vec3(x1, y0, z0), dz, dy, green);     // right
+
+    int panel = world.make_material<diffuse_light>(vec3(12, 12, 12));
+    add_quad(world, vec3(-0.3f, y1 - 0.01f, -1.3f), vec3(0.6f, 0, 0), vec3(0, 0, 0.6f), panel);
+    world.add_sphere(vec3(-1.3f, 0.9f, -2.1f), 0.06f, world.make_material<diffuse_light>(vec3(20, 14, 6)));
+
+    world.add_sphere(vec3(0, 0, -1), 0.2, world.make_material<lambertian>(vec3(0.8, 0.3, 0.3)));
+    world.add_cube(vec3(-0.7, 0, -1), 0.5, world.make_material<lambertian>(vec3(0.2, 0.1, 0.9)));
+    world.add_cube(vec3(0.0, 0, -1), 0.5, world.make_material<dielectric>(1.5));
+    world.add_sphere(vec3(0.5, 0, -1.2), 0.2, world.make_material<metal>(vec3(0.0, 1, 0.7), 0.1));
+}
+
+// count random small spheres in front of the default camera, for scaling tests
+void sphere_field(scene &world, int count, uint64_t seed) {
+    pcg32 rng;
+    rng.seed(mix64(seed), 7);
+    auto rnd = [&rng](float lo, float hi) { return lo + (hi - lo) * rng.next_float(); };
+
+    world.add_sphere(vec3(0, -100.5, -1), 100, world.make_material<lambertian>(vec3(0.5, 0.5, 0.5)));
+
+    // keep the density constant, so the spheres shrink as the count grows
+    const float volume = 4.0f * 1.5f * 3.0f;
+    float radius = 0.35f * std::cbrt(volume / float(count));
+    for (int i = 0; i < count; i++) {
+        vec3 center(rnd(-2.5f, 1.5f), rnd(-0.5f, 1.0f), rnd(-4.0f, -1.0f));
+        float choose = rng.next_float();
+        int mat;
+        if (choose < 0.8f) {
+            mat = world.make_material<lambertian>(vec3(rnd(0, 1) * rnd(0, 1), rnd(0, 1) * rnd(0, 1), rnd(0, 1) * rnd(0, 1)));
+        } else if (choose < 0.95f) {
+            mat = world.make_material<metal>(vec3(rnd(0.5f, 1), rnd(0.5f, 1), rnd(0.5f, 1)), rnd(0, 0.5f));
+        } else {
+            mat = world.make_material<dielectric>(1.5);
+        }
+        world.add_sphere(center, radius, mat);
+    }
+}
+
+// count randomly turned cubes in the same volume as sphere_field, all
+// instances of the one unit cube mesh
+void cube_field(scene &world, int count, uint64_t seed) {
+    pcg32 rng;
+    rng.seed(mix64(seed), 9);
+    auto rnd = [&rng](float lo, float hi) { return lo + (hi - lo) * rng.next_float(); };
+
+    world.add_sphere(vec3(0, -100.5, -1), 100, world.make_material<lambertian>(vec3(0.5, 0.5, 0.5)));
+    // a handful of shared materials, so the cubes are what takes the memory
+    int palette[8];
+    for (int k = 0; k < 6; k++) palette[k] = world.make_material<lambertian>(vec3(rnd(0.1f, 0.9f), rnd(0.1f, 0.9f), rnd(0.1f, 0.9f)));
+    palette[6] = world.make_material<metal>(vec3(0.8, 0.8, 0.8), 0.1f);
+    palette[7] = world.make_material<dielectric>(1.5);
+
+    const float volume = 4.0f * 1.5f * 3.0f;
+    float size = 0.5f * std::cbrt(volume / float(count));
+    int cube = world.cube_mesh();
+    for (int i = 0; i < count; i++) {
+        vec3 center(rnd(-2.5f, 1.5f), rnd(-0.5f, 1.0f), rnd(-4.0f, -1.0f));
+        vec3 axis(rnd(-1, 1), rnd(-1, 1), rnd(-1, 1));
+        if (axis.squared_length() < 1e-4f) axis = vec3(0, 1, 0);
+        affine to_world = affine::translate(center) * affine::rotate(axis, rnd(0, 360)) *
+                          affine::scale(vec3(size, size, size));
+        world.add_instance(cube, to_world, palette[rng.next_uint() % 8]);
+    }
+}
+
+// latitude/longitude sphere with 2 * segments^2 triangles, a stand-in for a large asset
+void uv_sphere_mesh(int segments, std::vector<vec3> &positions, std::vector<uint32_t> &indices) {
+    int rings = segments, sectors = 2 * segments;
+    positions.clear();
+    indices.clear();
+    for (int i = 0; i <= rings; i++) {
+        float theta = float(M_PI) * i / rings;
+        for (int j = 0; j < sectors; j++) {
+            float phi = 2 * float(M_PI) * j / sectors;
+            positions.emplace_back(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+        }
+    }
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < sectors; j++) {
+            uint32_t a = i * sectors + j, b = i * sectors + (j + 1) % sectors;
+            uint32_t c = a + sectors, d = b + sectors;
+            if (i > 0) indices.insert(indices.end(), {a, b, c});
+            if (i < rings - 1) indices.insert(indices.end(), {b, d, c});
+        }
+    }
+}
+
+// scales and moves the vertices so the mesh fits a box of the given size at center
+void fit_mesh(std::vector<vec3> &positions, const vec3 &center, float size) {
+    aabb box;
+    for (const vec3 &p : positions) box.expand(p);
+    vec3 d = box.extent();
+    float scale = size / std::max(d[0], std::max(d[1], d[2]));
+    vec3 c = box.centroid();
+    for (vec3 &p : positions) p = (p - c) * scale + center;
+}
+
+// one mesh on the ground, from an OBJ file or (without one) a generated sphere of about count triangles
+bool mesh_scene(scene &world, const std::string &obj_path, int count, bool print_stats) {
+    std::vector<vec3> positions;
+    std::vector<uint32_t> indices;
+    if (!obj_path.empty()) {
+        obj_load_stats load;
+        if (!load_obj(obj_path, positions, indices, &load)) return false;
+        if (print_stats) load.print(obj_path.c_str());
+    } else {
+        uv_sphere_mesh(std::max(2, int(std::sqrt(count / 2.0))), positions, indices);
+    }
+    fit_mesh(positions, vec3(0, -0.1, -1), 0.8);
+
+    world.add_sphere(vec3(0, -100.5, -1), 100, world.make_material<lambertian>(vec3(0.8, 0.8, 0.0)));
+    material *clay = world.materials[world.make_material<lambertian>(vec3(0.7, 0.6, 0.5))];
+    triangle_mesh *mesh = world.make_object<triangle_mesh>(std::move(positions), std::move(indices), clay);
+    if (print_stats) {
+        mesh->tree.stats.print("mesh bvh");
+        fprintf(stderr, "mesh: %zu triangles, %.1f MB, %.1f bytes per triangle\n", mesh->triangle_count(),
+                mesh->memory_bytes() / 1e6, double(mesh->memory_bytes()) / std::max<size_t>(1, mesh->triangle_count()));
+    }
+    return true;
+}
+
+#endif //CPU_CPP_RAYTRACING_SCENES_H
@@ -0,0 +1,356 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_SIMD_H
+#define CPU_CPP_RAYTRACING_SIMD_H
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include "ray.h"
+#include "vec3.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_SIMD_X86 1
+#define RT_SIMD_AVX2 1
+#include <immintrin.h>
+#define RT_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_M_X64)
+#define RT_SIMD_X86 1
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+inline int lowest_set_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (int)i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// One ray against up to 8 primitives at a time. Primitives are stored as
+// 8-wide structure-of-arrays packets; lanes at or past count are ignored.
+const int packet_width = 8;
+
+struct alignas(32) triangle_packet {
+    float v0[3][packet_width];
+    float e1[3][packet_width];  // v1 - v0
+    float e2[3][packet_width];  // v2 - v0
+
+    void set(int lane, const vec3 &a, const vec3 &b, const vec3 &c) {
+        for (int k = 0; k < 3; k++) {
+            v0[k][lane] = a[k];
+            e1[k][lane] = b[k] - a[k];
+            e2[k][lane] = c[k] - a[k];
+        }
+    }
+    void corners(int lane, vec3 &a, vec3 &edge1, vec3 &edge2) const {
+        a = vec3(v0[0][lane], v0[1][lane], v0[2][lane]);
+        edge1 = vec3(e1[0][lane], e1[1][lane], e1[2][lane]);
+        edge2 = vec3(e2[0][lane], e2[1][lane], e2[2][lane]);
+    }
+    vec3 normal(int lane) const {
+        vec3 a(e1[0][lane], e1[1][lane], e1[2][lane]);
+        vec3 b(e2[0][lane], e2[1][lane], e2[2][lane]);
+        return unit_vector(cross(a, b));
+    }
+};
+
+struct alignas(32) sphere_packet {
+    float center[3][packet_width];
+    float radius[packet_width];
+
+    void set(int lane, const vec3 &c, float r) {
+        for (int k = 0; k < 3; k++) center[k][lane] = c[k];
+        radius[lane] = r;
+    }
+};
+
+// Both kernels return the lane of the closest hit in (t_min, t_max) and
+// shrink t_max to it, or return -1 and leave t_max alone.
+typedef int (*triangle_kernel)(const ray &r, const triangle_packet &p, int count, float t_min, float &t_max);
+typedef int (*sphere_kernel)(const ray &r, const sphere_packet &p, int count, float t_min, float &t_max);
+
+int intersect_triangles_scalar(const ray &r, const triangle_packet &p, int count, float t_min, float &t_max) {
+    constexpr float epsilon = std::numeric_limits<float>::epsilon();
+    int hit = -1;
+    for (int k = 0; k < count; k++) {
+        vec3 e1(p.e1[0][k], p.e1[1][k], p.e1[2][k]);
+        vec3 e2(p.e2[0][k], p.e2[1][k], p.e2[2][k]);
+        vec3 pvec = cross(r.b, e2);
+        float det = dot(e1, pvec);
+        if (det > -epsilon && det < epsilon) continue;
+        float inv_det = 1.0f / det;
+        vec3 tvec = r.a - vec3(p.v0[0][k], p.v0[1][k], p.v0[2][k]);
+        float u = inv_det * dot(tvec, pvec);
+        if (u < 0.0f || u > 1.0f) continue;
+        vec3 qvec = cross(tvec, e1);
+        float v = inv_det * dot(r.b, qvec);
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float t = inv_det * dot(e2, qvec);
+        if (t > t_min && t < t_max) {
+            t_max = t;
+            hit = k;
+        }
+    }
+    return hit;
+}
+
+int intersect_spheres_scalar(const ray &r, const sphere_packet &p, int count, float t_min, float &t_max) {
+    float a = dot(r.b, r.b);
+    int hit = -1;
+    for (int k = 0; k < count; k++) {
+        vec3 oc = r.a - vec3(p.center[0][k], p.center[1][k], p.center[2][k]);
+        float b = dot(oc, r.b);
+        float c = dot(oc, oc) - p.radius[k] * p.radius[k];
+        float discriminant = b * b - a * c;
+        if (discriminant <= 0) continue;
+        float s = sqrt(discriminant);
+        float t = (-b - s) / a;
+        if (!(t < t_max && t > t_min)) t = (-b + s) / a;
+        if (t < t_max && t > t_min) {
+            t_max = t;
+            hit = k;
+        }
+    }
+    return hit;
+}
+
+#ifdef RT_SIMD_X86
+// 4 lanes, the SSE2 baseline every x86-64 cpu has; a packet is two halves
+struct sse_ray {
+    __m128 o[3], d[3], a;
+    explicit sse_ray(const ray &r) {
+        for (int k = 0; k < 3; k++) {
+            o[k] = _mm_set1_ps(r.a[k]);
+            d[k] = _mm_set1_ps(r.b[k]);
+        }
+        a = _mm_set1_ps(dot(r.b, r.b));
+    }
+};
+
+inline __m128 sse_select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 sse_lane_mask(int half, int count) {
+    __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+    return _mm_cmplt_ps(lanes, _mm_set1_ps(float(count - 4 * half)));
+}
+
+// folds the candidate t values of one half into (best_t, best_lane)
+inline void sse_reduce(__m128 t, __m128 valid, int half, float &t_max, int &hit) {
+    t = sse_select(valid, t, _mm_set1_ps(INFINITY));
+    __m128 m = _mm_min_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+    m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    int mask = _mm_movemask_ps(_mm_and_ps(valid, _mm_cmpeq_ps(t, m)));
+    if (mask) {
+        t_max = _mm_cvtss_f32(m);
+        hit = 4 * half + lowest_set_bit(mask);
+    }
+}
+
+int intersect_triangles_sse(const ray &r, const triangle_packet &p, int count, float t_min, float &t_max) {
+    sse_ray rr(r);
+    const __m128 eps = _mm_set1_ps(std::numeric_limits<float>::epsilon());
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    int hit = -1;
+    for (int half = 0; half * 4 < count; half++) {
+        int o = 4 * half;
+        __m128 e1[3], e2[3], tvec[3];
+        for (int k = 0; k < 3; k++) {
+            e1[k] = _mm_load_ps(&p.e1[k][o]);
+            e2[k] = _mm_load_ps(&p.e2[k][o]);
+            tvec[k] = _mm_sub_ps(rr.o[k], _mm_load_ps(&p.v0[k][o]));
+        }
+        __m128 px = _mm_sub_ps(_mm_mul_ps(rr.d[1], e2[2]), _mm_mul_ps(rr.d[2], e2[1]));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(rr.d[2], e2[0]), _mm_mul_ps(rr.d[0], e2[2]));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(rr.d[0], e2[1]), _mm_mul_ps(rr.d[1], e2[0]));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], px), _mm_mul_ps(e1[1], py)), _mm_mul_ps(e1[2], pz));
+        __m128 valid = _mm_and_ps(sse_lane_mask(half, count), _mm_cmpge_ps(_mm_and_ps(det, abs_mask), eps));
+        __m128 inv_det = _mm_div_ps(one, det);
+
+        __m128 u = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(tvec[0], px), _mm_mul_ps(tvec[1], py)),
+                                                  _mm_mul_ps(tvec[2], pz)));
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(tvec[1], e1[2]), _mm_mul_ps(tvec[2], e1[1]));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(tvec[2], e1[0]), _mm_mul_ps(tvec[0], e1[2]));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tvec[0], e1[1]), _mm_mul_ps(tvec[1], e1[0]));
+        __m128 v = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(rr.d[0], qx), _mm_mul_ps(rr.d[1], qy)),
+                                                  _mm_mul_ps(rr.d[2], qz)));
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+        __m128 t = _mm_mul_ps(inv_det, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], qx), _mm_mul_ps(e2[1], qy)),
+                                                  _mm_mul_ps(e2[2], qz)));
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, _mm_set1_ps(t_min)), _mm_cmplt_ps(t, _mm_set1_ps(t_max))));
+        if (_mm_movemask_ps(valid)) sse_reduce(t, valid, half, t_max, hit);
+    }
+    return hit;
+}
+
+int intersect_spheres_sse(const ray &r, const sphere_packet &p, int count, float t_min, float &t_max) {
+    sse_ray rr(r);
+    int hit = -1;
+    for (int half = 0; half * 4 < count; half++) {
+        int o = 4 * half;
+        __m128 oc[3];
+        for (int k = 0; k < 3; k++) oc[k] = _mm_sub_ps(rr.o[k], _mm_load_ps(&p.center[k][o]));
+        __m128 rad = _mm_load_ps(&p.radius[o]);
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(oc[0], rr.d[0]), _mm_mul_ps(oc[1], rr.d[1])), _mm_mul_ps(oc[2], rr.d[2]));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(oc[0], oc[0]), _mm_mul_ps(oc[1], oc[1])),
+                                         _mm_mul_ps(oc[2], oc[2])), _mm_mul_ps(rad, rad));
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(rr.a, c));
+        __m128 valid = _mm_and_ps(sse_lane_mask(half, count), _mm_cmpgt_ps(disc, _mm_setzero_ps()));
+        if (!_mm_movemask_ps(valid)) continue;
+
+        __m128 s = _mm_sqrt_ps(disc);
+        __m128 lo = _mm_set1_ps(t_min), hi = _mm_set1_ps(t_max);
+        __m128 t0 = _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(b, s)), rr.a);
+        __m128 t1 = _mm_div_ps(_mm_sub_ps(s, b), rr.a);
+        __m128 in0 = _mm_and_ps(_mm_cmplt_ps(t0, hi), _mm_cmpgt_ps(t0, lo));
+        __m128 in1 = _mm_and_ps(_mm_cmplt_ps(t1, hi), _mm_cmpgt_ps(t1, lo));
+        __m128 t = sse_select(in0, t0, t1);
+        valid = _mm_and_ps(valid, _mm_or_ps(in0, in1));
+        if (_mm_movemask_ps(valid)) sse_reduce(t, valid, half, t_max, hit);
+    }
+    return hit;
+}
+#endif
+
+#ifdef RT_SIMD_AVX2
+// all 8 lanes of a packet in one go
+RT_TARGET_AVX2 inline __m256 avx_lane_mask(int count) {
+    return _mm256_cmp_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(float(count)), _CMP_LT_OQ);
+}
+
+RT_TARGET_AVX2 inline int avx_reduce(__m256 t, __m256 valid, float &t_max) {
+    t = _mm256_blendv_ps(_mm256_set1_ps(INFINITY), t, valid);
+    __m256 m = _mm256_min_ps(t, _mm256_permute2f128_ps(t, t, 1));
+    m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm256_min_ps(m, _mm256_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    int mask = _mm256_movemask_ps(_mm256_and_ps(valid, _mm256_cmp_ps(t, m, _CMP_EQ_OQ)));
+    t_max = _mm256_cvtss_f32(m);
+    return lowest_set_bit(mask);
+}
+
+RT_TARGET_AVX2 int intersect_triangles_avx2(const ray &r, const triangle_packet &p, int count, float t_min, float &t_max) {
+    __m256 d[3], e1[3], e2[3], tvec[3];
+    for (int k = 0; k < 3; k++) {
+        d[k] = _mm256_set1_ps(r.b[k]);
+        e1[k] = _mm256_load_ps(p.e1[k]);
+        e2[k] = _mm256_load_ps(p.e2[k]);
+        tvec[k] = _mm256_sub_ps(_mm256_set1_ps(r.a[k]), _mm256_load_ps(p.v0[k]));
+    }
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 px = _mm256_sub_ps(_mm256_mul_ps(d[1], e2[2]), _mm256_mul_ps(d[2], e2[1]));
+    __m256 py = _mm256_sub_ps(_mm256_mul_ps(d[2], e2[0]), _mm256_mul_ps(d[0], e2[2]));
+    __m256 pz = _mm256_sub_ps(_mm256_mul_ps(d[0], e2[1]), _mm256_mul_ps(d[1], e2[0]));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1[0], px), _mm256_mul_ps(e1[1], py)), _mm256_mul_ps(e1[2], pz));
+    __m256 abs_det = _mm256_and_ps(det, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+    __m256 valid = _mm256_and_ps(avx_lane_mask(count),
+                                 _mm256_cmp_ps(abs_det, _mm256_set1_ps(std::numeric_limits<float>::epsilon()), _CMP_GE_OQ));
+    __m256 inv_det = _mm256_div_ps(one, det);
+
+    __m256 u = _mm256_mul_ps(inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tvec[0], px), _mm256_mul_ps(tvec[1], py)),
+                                                    _mm256_mul_ps(tvec[2], pz)));
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+
+    __m256 qx = _mm256_sub_ps(_mm256_mul_ps(tvec[1], e1[2]), _mm256_mul_ps(tvec[2], e1[1]));
+    __m256 qy = _mm256_sub_ps(_mm256_mul_ps(tvec[2], e1[0]), _mm256_mul_ps(tvec[0], e1[2]));
+    __m256 qz = _mm256_sub_ps(_mm256_mul_ps(tvec[0], e1[1]), _mm256_mul_ps(tvec[1], e1[0]));
+    __m256 v = _mm256_mul_ps(inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d[0], qx), _mm256_mul_ps(d[1], qy)),
+                                                    _mm256_mul_ps(d[2], qz)));
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ),
+                                               _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+
+    __m256 t = _mm256_mul_ps(inv_det, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2[0], qx), _mm256_mul_ps(e2[1], qy)),
+                                                    _mm256_mul_ps(e2[2], qz)));
+    valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, _mm256_set1_ps(t_min), _CMP_GT_OQ),
+                                               _mm256_cmp_ps(t, _mm256_set1_ps(t_max), _CMP_LT_OQ)));
+    if (!_mm256_movemask_ps(valid)) return -1;
+    return avx_reduce(t, valid, t_max);
+}
+
+RT_TARGET_AVX2 int intersect_spheres_avx2(const ray &r, const sphere_packet &p, int count, float t_min, float &t_max) {
+    __m256 oc[3], d[3];
+    for (int k = 0; k < 3; k++) {
+        d[k] = _mm256_set1_ps(r.b[k]);
+        oc[k] = _mm256_sub_ps(_mm256_set1_ps(r.a[k]), _mm256_load_ps(p.center[k]));
+    }
+    __m256 a = _mm256_set1_ps(dot(r.b, r.b));
+    __m256 rad = _mm256_load_ps(p.radius);
+    __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(oc[0], d[0]), _mm256_mul_ps(oc[1], d[1])), _mm256_mul_ps(oc[2], d[2]));
+    __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(oc[0], oc[0]), _mm256_mul_ps(oc[1], oc[1])),
+                                           _mm256_mul_ps(oc[2], oc[2])), _mm256_mul_ps(rad, rad));
+    __m256 disc = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+    __m256 valid = _mm256_and_ps(avx_lane_mask(count), _mm256_cmp_ps(disc, _mm256_setzero_ps(), _CMP_GT_OQ));
+    if (!_mm256_movemask_ps(valid)) return -1;
+
+    __m256 s = _mm256_sqrt_ps(disc);
+    __m256 lo = _mm256_set1_ps(t_min), hi = _mm256_set1_ps(t_max);
+    __m256 t0 = _mm256_div_ps(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(b, s)), a);
+    __m256 t1 = _mm256_div_ps(_mm256_sub_ps(s, b), a);
+    __m256 in0 = _mm256_and_ps(_mm256_cmp_ps(t0, hi, _CMP_LT_OQ), _mm256_cmp_ps(t0, lo, _CMP_GT_OQ));
+    __m256 in1 = _mm256_and_ps(_mm256_cmp_ps(t1, hi, _CMP_LT_OQ), _mm256_cmp_ps(t1, lo, _CMP_GT_OQ));
+    __m256 t = _mm256_blendv_ps(t1, t0, in0);
+    valid = _mm256_and_ps(valid, _mm256_or_ps(in0, in1));
+    if (!_mm256_movemask_ps(valid)) return -1;
+    return avx_reduce(t, valid, t_max);
+}
+#endif
+
+enum simd_level { simd_scalar, simd_sse, simd_avx2 };
+
+struct simd_kernels {
+    simd_level level;
+    const char *name;
+    triangle_kernel triangles;
+    sphere_kernel spheres;
+};
+
+simd_level best_simd_level() {
+#if defined(RT_SIMD_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return simd_avx2;
+    return simd_sse;
+#elif defined(RT_SIMD_X86)
+    return simd_sse;
+#else
+    return simd_scalar;
+#endif
+}
+
+simd_kernels make_simd_kernels(simd_level level) {
+    switch (level) {
+#ifdef RT_SIMD_AVX2
+        case simd_avx2: return {simd_avx2, "avx2", intersect_triangles_avx2, intersect_spheres_avx2};
+#endif
+#ifdef RT_SIMD_X86
+        case simd_sse: return {simd_sse, "sse", intersect_triangles_sse, intersect_spheres_sse};
+#endif
+        default: return {simd_scalar, "scalar", intersect_triangles_scalar, intersect_spheres_scalar};
+    }
+}
+
+// the kernels in use; picked once at startup, --simd can lower the level
+simd_kernels simd = make_simd_kernels(best_simd_level());
+
+// returns false for a level this cpu or build cannot run
+bool select_simd(const char *name) {
+    simd_level level;
+    if (!strcmp(name, "scalar")) level = simd_scalar;
+    else if (!strcmp(name, "sse")) level = simd_sse;
+    else if (!strcmp(name, "avx2")) level = simd_avx2;
+    else return false;
+    if (level > best_simd_level()) return false;
+    simd = make_simd_kernels(level);
+    return true;
+}
+
+#endif //CPU_CPP_RAYTRACING_SIMD_H
@@ -14,6 +14,11 @@ public:
     material *mat_ptr;
     sphere(const vec3 &c, float r,material *mat) : center(c), radius(r), mat_ptr(mat){}
     virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const;
+    virtual bool bounding_box(aabb &box) const {
+        vec3 rad(radius, radius, radius);
+        box = aabb(center - rad, center + rad);
+        return true;
+    }
 };
 
 bool sphere::hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
@@ -29,6 +34,7 @@ bool sphere::hit(const ray &r, float t_min, float t_max, hit_record &rec) const
             rec.p = r.point_at_parameter(rec.t);
             rec.normal = (rec.p - center) / radius;
             rec.mat_ptr = mat_ptr;
+            set_sphere_uv(radius, rec);
             return true;
         }
         temp = (-b + sqrt(discriminant)) / a;
@@ -37,6 +43,7 @@ bool sphere::hit(const ray &r, float t_min, float t_max, hit_record &rec) const
             rec.p = r.point_at_parameter(rec.t);
             rec.normal = (rec.p - center) / radius;
             rec.mat_ptr = mat_ptr;
+            set_sphere_uv(radius, rec);
             return true;
         }
     }
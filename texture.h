@@ -0,0 +1,48 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_TEXTURE_H
+#define CPU_CPP_RAYTRACING_TEXTURE_H
+#include <algorithm>
+#include <cmath>
+
+#include "hitable.h"
+#include "noise.h"
+#include "vec3.h"
+
+// What a material reads its color from at a hit. The procedural textures
+// here are solid: they look only at the hit point, so they need no surface
+// parameterization and show no seams.
+class texture {
+public:
+    virtual ~texture() = default;
+    virtual vec3 value(const hit_record &rec) const = 0;
+};
+
+// Two colors blended by fBm of the hit point times scale. fbm uses the
+// noise directly (clouds, stone); marble runs it through a sine along x,
+// so the noise bends bands into veins.
+class noise_texture : public texture {
+public:
+    enum pattern { pattern_fbm, pattern_marble };
+
+    vec3 low, high;
+    float scale;
+    pattern kind;
+    fbm_settings settings;
+
+    noise_texture(const vec3 &low, const vec3 &high, float scale, pattern kind = pattern_fbm,
+                  const fbm_settings &settings = {})
+        : low(low), high(high), scale(scale), kind(kind), settings(settings) {}
+
+    virtual vec3 value(const hit_record &rec) const {
+        vec3 p = rec.p * scale;
+        float n = fbm(p, settings);
+        float t = kind == pattern_marble ? 0.5f * (1 + std::sin(p.x() + 6 * n)) : 0.5f * (1 + 1.5f * n);
+        t = std::clamp(t, 0.0f, 1.0f);
+        return low * (1 - t) + high * t;
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_TEXTURE_H
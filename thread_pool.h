@@ -0,0 +1,140 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_THREAD_POOL_H
+#define CPU_CPP_RAYTRACING_THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+int default_thread_count() {
+    int num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 4;
+    return num_threads;
+}
+
+// Persistent workers for tiled render passes. The threads are started once and
+// sleep between passes. Every pass deals each worker a contiguous run of tiles;
+// a worker that runs out steals from the back of the other queues, so a few
+// expensive tiles no longer hold up the whole pass.
+class tile_scheduler {
+public:
+    // the calling thread works as worker 0, so num_threads - 1 threads are spawned
+    explicit tile_scheduler(int num_threads) : queues(num_threads) {
+        for (auto &q : queues) q = std::make_unique<tile_queue>();
+        for (int w = 1; w < num_threads; w++) {
+            threads.emplace_back(&tile_scheduler::worker_loop, this, w);
+        }
+    }
+
+    ~tile_scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake_cv.notify_all();
+        for (auto &t : threads) t.join();
+    }
+
+    tile_scheduler(const tile_scheduler &) = delete;
+    tile_scheduler &operator=(const tile_scheduler &) = delete;
+
+    int size() const { return (int)queues.size(); }
+
+    // calls job(tile, worker) for every tile in [0, num_tiles) and returns once all finished
+    void run(int num_tiles, const std::function<void(int, int)> &job) {
+        if (num_tiles <= 0) return;
+        current_job = &job;
+        remaining.store(num_tiles);
+
+        int n = size();
+        for (int w = 0; w < n; w++) {
+            std::lock_guard<std::mutex> lock(queues[w]->mutex);
+            for (int tile = num_tiles * w / n; tile < num_tiles * (w + 1) / n; tile++) {
+                queues[w]->tiles.push_back(tile);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+        }
+        wake_cv.notify_all();
+
+        drain(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this] { return remaining.load() == 0; });
+    }
+
+private:
+    struct tile_queue {
+        std::mutex mutex;
+        std::deque<int> tiles;
+    };
+
+    std::vector<std::unique_ptr<tile_queue>> queues;
+    std::vector<std::thread> threads;
+    const std::function<void(int, int)> *current_job = nullptr;
+    std::atomic<int> remaining{0};
+
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    std::condition_variable done_cv;
+    unsigned generation = 0;
+    bool stopping = false;
+
+    bool pop_own(int worker, int &tile) {
+        tile_queue &q = *queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tiles.empty()) return false;
+        tile = q.tiles.front();
+        q.tiles.pop_front();
+        return true;
+    }
+
+    bool steal(int thief, int &tile) {
+        int n = size();
+        for (int k = 1; k < n; k++) {
+            tile_queue &q = *queues[(thief + k) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tiles.empty()) {
+                tile = q.tiles.back();
+                q.tiles.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drain(int worker) {
+        int tile;
+        while (pop_own(worker, tile) || steal(worker, tile)) {
+            (*current_job)(tile, worker);
+            if (remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done_cv.notify_all();
+            }
+        }
+    }
+
+    void worker_loop(int worker) {
+        unsigned seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(worker);
+        }
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_THREAD_POOL_H
@@ -0,0 +1,95 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_TRIANGLE_MESH_H
+#define CPU_CPP_RAYTRACING_TRIANGLE_MESH_H
+#include <cstdint>
+#include <vector>
+#include "bvh.h"
+#include "hitable.h"
+#include "render_stats.h"
+#include "simd.h"
+
+// Builds a BVH over indexed triangles (3 indices each) and bakes every leaf
+// (up to 8 triangles) into one triangle_packet holding the precomputed
+// Möller–Trumbore data (v0, edge1, edge2), tested with one SIMD kernel call.
+// The leaf offsets of tree then index packets.
+void pack_triangles(const std::vector<vec3> &positions, const std::vector<uint32_t> &indices, bvh_tree &tree,
+                    std::vector<triangle_packet> &packets) {
+    size_t count = indices.size() / 3;
+    std::vector<aabb> bounds(count);
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < 3; k++) bounds[i].expand(positions[indices[3 * i + k]]);
+    }
+    // a whole packet costs about as much as two scalar tests
+    tree.build(bounds, packet_width, 0.25f);
+
+    packets.clear();
+    for (bvh_node &node : tree.nodes) {
+        if (node.count == 0) continue;
+        triangle_packet packet = {};
+        for (int lane = 0; lane < node.count; lane++) {
+            const uint32_t *tri = &indices[3 * size_t(tree.prim_index[node.offset + lane])];
+            packet.set(lane, positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        }
+        node.offset = (int)packets.size();
+        packets.push_back(packet);
+    }
+    packets.shrink_to_fit();
+    // the leaf order is baked into the packets
+    tree.prim_index.clear();
+    tree.prim_index.shrink_to_fit();
+}
+
+// Indexed triangle mesh with its own BVH (see pack_triangles). The vertex
+// and index buffers are only needed to build the packets and freed after.
+class triangle_mesh : public hitable {
+public:
+    std::vector<triangle_packet> packets;
+    bvh_tree tree;                      // leaf offsets index packets
+    size_t triangles;
+    material *mat_ptr;
+
+    triangle_mesh(std::vector<vec3> positions, std::vector<uint32_t> indices, material *mat)
+        : triangles(indices.size() / 3), mat_ptr(mat) {
+        pack_triangles(positions, indices, tree, packets);
+    }
+
+    virtual bool hit(const ray &r, float t_min, float t_max, hit_record &rec) const {
+        float closest = t_max;
+        int hit_packet = -1, hit_lane = -1;
+        triangle_kernel kernel = simd.triangles;
+        tree.intersect(r, t_min, closest, [&](int packet, int count, float &closest_t) {
+            RT_STAT(render_stats::local().prim_tests[prim_triangle_packet]++);
+            int lane = kernel(r, packets[packet], count, t_min, closest_t);
+            if (lane < 0) return false;
+            hit_packet = packet;
+            hit_lane = lane;
+            return true;
+        });
+        if (hit_packet < 0) return false;
+
+        rec.t = closest;
+        rec.p = r.point_at_parameter(closest);
+        rec.normal = packets[hit_packet].normal(hit_lane);
+        rec.mat_ptr = mat_ptr;
+        vec3 v0, e1, e2;
+        packets[hit_packet].corners(hit_lane, v0, e1, e2);
+        set_triangle_uv(v0, e1, e2, rec);
+        return true;
+    }
+
+    virtual bool bounding_box(aabb &box) const {
+        box = tree.bounds();
+        return !packets.empty();
+    }
+
+    size_t triangle_count() const { return triangles; }
+
+    size_t memory_bytes() const {
+        return packets.capacity() * sizeof(triangle_packet) + tree.nodes.capacity() * sizeof(bvh_node);
+    }
+};
+
+#endif //CPU_CPP_RAYTRACING_TRIANGLE_MESH_H
@@ -0,0 +1,198 @@
+//
+// Created by karan on 10/17/2026.
+//
+
+#ifndef CPU_CPP_RAYTRACING_WAVEFRONT_H
+#define CPU_CPP_RAYTRACING_WAVEFRONT_H
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "camera.h"
+#include "film.h"
+#include "hitable.h"
+#include "integrator.h"
+#include "materials.h"
+#include "sampler.h"
+
+// Path state for the pixels of a tile, as a structure of arrays. Every path
+// keeps its own sampler, so it draws the same random numbers as the path
+// integrator would for its pixel.
+struct path_queue {
+    std::vector<float> org_x, org_y, org_z;
+    std::vector<float> dir_x, dir_y, dir_z;         // unit length
+    std::vector<float> weight_r, weight_g, weight_b; // throughput so far
+    std::vector<float> radiance_r, radiance_g, radiance_b;
+    std::vector<float> bsdf_pdf;                    // of the last scatter, see emission_weight
+    std::vector<ray_cone> cones;
+    std::vector<sampler> samplers;
+    std::vector<int> pixel;                         // film index
+
+    void resize(int n) {
+        for (std::vector<float>* v : {&org_x, &org_y, &org_z, &dir_x, &dir_y, &dir_z,
+                                      &weight_r, &weight_g, &weight_b, &radiance_r, &radiance_g, &radiance_b, &bsdf_pdf}) {
+            v->resize(n);
+        }
+        cones.resize(n);
+        samplers.resize(n);
+        pixel.resize(n);
+    }
+
+    ray get_ray(int i) const {
+        // assigned directly: the stored direction is already normalized
+        ray r;
+        r.a = vec3(org_x[i], org_y[i], org_z[i]);
+        r.b = vec3(dir_x[i], dir_y[i], dir_z[i]);
+        return r;
+    }
+
+    void set_ray(int i, const ray& r) {
+        org_x[i] = r.a[0]; org_y[i] = r.a[1]; org_z[i] = r.a[2];
+        dir_x[i] = r.b[0]; dir_y[i] = r.b[1]; dir_z[i] = r.b[2];
+    }
+
+    void add_radiance(int i, const vec3& l) {
+        radiance_r[i] += l[0];
+        radiance_g[i] += l[1];
+        radiance_b[i] += l[2];
+    }
+};
+
+// per worker thread, reused by every tile it renders
+struct wavefront_state {
+    path_queue paths;
+    std::vector<hit_record> hits;                   // by path
+    std::vector<int> active, next_active;           // live path indices
+    std::vector<int> queues[material_type_count];    // hit paths by material type
+};
+
+// Shades every queued path with one concrete material type. The qualified
+// call skips the virtual dispatch, so the loop body is the same scatter code
+// (and the same kind of material data) for the whole batch. material_t =
+// material is the catch-all queue and goes through the virtual call. Light
+// sampling comes first, in the path integrator's order of random numbers.
+template <class material_t>
+void shade_queue(wavefront_state& st, const std::vector<int>& queue, int type, int depth, const bounce_policy& bounces,
+                 hitable* world) {
+    path_queue& paths = st.paths;
+    if (depth >= bounces.max_depth[type]) return;
+    const light_list* lights = world->lights();
+    for (int i : queue) {
+        const hit_record& rec = st.hits[i];
+        ray r_in = paths.get_ray(i);
+        vec3 weight = vec3(paths.weight_r[i], paths.weight_g[i], paths.weight_b[i]);
+        bool direct = lights && rec.mat_ptr->samples_lights();
+        if (direct) paths.add_radiance(i, weight * sample_direct(r_in, rec, world, *lights, paths.samplers[i]));
+        ray scattered;
+        vec3 attenuation;
+        bool scattered_ok;
+        RT_STAT(render_stats::local().scatter_calls[type]++);
+        if constexpr (std::is_same_v<material_t, material>) {
+            scattered_ok = rec.mat_ptr->scatter(r_in, rec, attenuation, scattered, paths.samplers[i]);
+        } else {
+            const material_t* mat = static_cast<const material_t*>(rec.mat_ptr);
+            scattered_ok = mat->material_t::scatter(r_in, rec, attenuation, scattered, paths.samplers[i]);
+        }
+        if (!scattered_ok) continue;
+        paths.bsdf_pdf[i] = direct ? rec.mat_ptr->pdf(r_in, rec, scattered.direction()) : 0;
+        weight *= attenuation;
+        if (!bounces.survive(type, depth, weight, paths.samplers[i])) continue;
+        paths.cones[i].scatter(*rec.mat_ptr);
+        paths.weight_r[i] = weight[0];
+        paths.weight_g[i] = weight[1];
+        paths.weight_b[i] = weight[2];
+        paths.set_ray(i, scattered);
+        st.next_active.push_back(i);
+    }
+}
+
+// Wavefront version of render_tile: instead of following one path to the end
+// before starting the next, all paths of the tile advance one bounce at a
+// time through four stages:
+//   generate  - camera rays for every pixel that has not converged
+//   extend    - closest hit for every live path; misses pick up the sky,
+//               hits on lights their emission
+//   shade     - light sampling and scatter, batched by material type
+//   terminate - absorbed paths, paths at their max depth and russian
+//               roulette victims drop out
+// The tracing and the material code each run in tight loops over many rays.
+int render_tile_wavefront(film& image, hitable* world, camera& cam,
+                          int start_x, int end_x, int start_y, int end_y, const render_settings& settings) {
+    static thread_local wavefront_state st;
+    path_queue& paths = st.paths;
+    const light_list* lights = world->lights();
+    int nx = image.nx, ny = image.ny;
+    paths.resize((end_x - start_x) * (end_y - start_y));
+    st.hits.resize(paths.pixel.size());
+    float spread = cam.pixel_spread(ny);
+
+    // generate, skipping converged pixels
+    st.active.clear();
+    int n = 0;
+    for (int j = start_y; j < end_y; j++) {
+        for (int i = start_x; i < end_x; i++) {
+            int idx = (ny - 1 - j) * nx + i;
+            if (image.converged[idx]) continue;
+            int k = n++;
+            paths.pixel[k] = idx;
+            sampler& s = paths.samplers[k];
+            s = sampler(settings.seed, settings.sampling, settings.sample_count);
+            s.start_pixel_sample(i, j, image.sample_index(idx));
+
+            point2 jitter = s.next_2d();
+            float u = float(i + jitter.x) / float(nx);
+            float v = float(j + jitter.y) / float(ny);
+            paths.set_ray(k, cam.get_ray(u, v));
+            RT_STAT(render_stats::local().camera_rays++);
+            paths.cones[k] = ray_cone{0, spread};
+            paths.weight_r[k] = paths.weight_g[k] = paths.weight_b[k] = 1;
+            paths.radiance_r[k] = paths.radiance_g[k] = paths.radiance_b[k] = 0;
+            paths.bsdf_pdf[k] = 0;
+            st.active.push_back(k);
+        }
+    }
+
+    for (int depth = 0; !st.active.empty(); depth++) {
+        // extend
+        for (std::vector<int>& queue : st.queues) queue.clear();
+        RT_STAT(render_stats::local().rays += st.active.size());
+        for (int k : st.active) {
+            hit_record& rec = st.hits[k];
+            ray r = paths.get_ray(k);
+            vec3 weight(paths.weight_r[k], paths.weight_g[k], paths.weight_b[k]);
+            if (!world->hit(r, 0.001, INFINITY, rec)) {
+                paths.add_radiance(k, weight * background(r.direction()));
+            } else if (rec.mat_ptr->type == material_light) {
+                // lights end the path, so they are never queued
+                if (dot(r.direction(), rec.normal) < 0) {
+                    vec3 emit = rec.mat_ptr->emitted(rec);
+                    paths.add_radiance(k, weight * emit * emission_weight(r, rec, lights, paths.bsdf_pdf[k], emit));
+                }
+            } else {
+                paths.cones[k].reach(rec);
+                st.queues[rec.mat_ptr->type].push_back(k);
+            }
+        }
+
+        // shade; absorbed paths, paths past their max depth and russian
+        // roulette victims are not queued for the next bounce (terminate)
+        const bounce_policy& bounces = settings.bounces;
+        st.next_active.clear();
+        shade_queue<lambertian>(st, st.queues[material_lambertian], material_lambertian, depth, bounces, world);
+        shade_queue<metal>(st, st.queues[material_metal], material_metal, depth, bounces, world);
+        shade_queue<dielectric>(st, st.queues[material_dielectric], material_dielectric, depth, bounces, world);
+        shade_queue<material>(st, st.queues[material_other], material_other, depth, bounces, world);
+        // every path that is not going on ends with this bounce's ray
+        RT_STAT(render_stats::local().path_length[std::min(depth + 1, path_length_buckets - 1)] +=
+                st.active.size() - st.next_active.size());
+        std::swap(st.active, st.next_active);
+    }
+
+    for (int k = 0; k < n; k++) {
+        int idx = paths.pixel[k];
+        image.add(idx, vec3(paths.radiance_r[k], paths.radiance_g[k], paths.radiance_b[k]));
+    }
+    return n;
+}
+
+#endif //CPU_CPP_RAYTRACING_WAVEFRONT_H